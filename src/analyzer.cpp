@@ -1,172 +1,157 @@
 #include "analyzer.hpp"
 
+#include <string>
+
+#include "common/ast.hpp"
 #include "common/error.hpp"
 #include "common/expression.hpp"
 #include "common/statements.hpp"
+#include "common/traversal.hpp"
 
-void Analyzer::analyze(std::vector<std::unique_ptr<Stmt>> &statements)
+void Analyzer::analyze()
 {
-    for (auto const &stmt : statements)
-    {
-        analyze_stmt(*stmt);
-    }
+    analyze_next();
+    finish();
+}
+
+void Analyzer::analyze_next() { walk(m_ast, m_ast.statements, *this); }
 
+void Analyzer::finish()
+{
     if (m_had_error)
     {
         error::fatal("Encountered an error during semantic analysis pass");
     }
 }
 
-void Analyzer::analyze_expr(Expr &expr)
+Analyzer::Analyzer(Ast &ast, std::span<common::Symbol const> globals)
+    : Analyzer(ast)
 {
-    switch (expr.kind)
+    for (common::Symbol symbol : globals)
     {
-    case ExprType::Binary:
-    {
-        analyze_expr(*expr.variant.binary.left);
-        analyze_expr(*expr.variant.binary.right);
-        break;
+        bind(symbol);
     }
-    case ExprType::Literal:
+}
+
+std::vector<common::Symbol> Analyzer::globals() const
+{
+    std::vector<common::Symbol> symbols;
+    symbols.reserve(m_vars.size());
+    for (Declaration const &var : m_vars)
     {
-        break;
+        symbols.push_back(var.symbol);
     }
-    case ExprType::Var:
+    return symbols;
+}
+
+Analyzer::Scoped &Analyzer::scoped(common::Symbol symbol)
+{
+    if (symbol >= m_bindings.size())
     {
-        VarExpr &var_expr = expr.variant.var;
-        bool is_declared = false;
-        for (int ix = m_vars.size() - 1; ix >= 0; --ix)
-        {
-            if (var_expr.var.token.lexeme == m_vars[ix].token.lexeme)
-            {
-                is_declared = true;
-                break;
-            }
-        }
-        if (!is_declared)
-        {
-            m_had_error = true;
-            error::report(
-                var_expr.var.token.line,
-                "Undeclared variable '" + var_expr.var.token.lexeme + "'"
-            );
-        }
-        break;
+        m_bindings.resize(symbol + 1);
     }
-    case ExprType::Assign:
+    return m_bindings[symbol];
+}
+
+Binding Analyzer::bind(common::Symbol symbol)
+{
+    Scoped &current = scoped(symbol);
+    m_vars.push_back({symbol, current});
+    uint32_t depth = static_cast<uint32_t>(m_frame_sizes.size() - 1);
+    current = {{depth, m_frame_sizes.back()++}, m_scope_depth};
+    return current.binding;
+}
+
+Binding Analyzer::declare(TokenRef name)
+{
+    if (scoped(m_ast.symbol(name)).scope_depth == m_scope_depth)
     {
-        AssignExpr &assign_expr = expr.variant.assign;
-        bool is_declared = false;
-        for (int ix = m_vars.size() - 1; ix >= 0; --ix)
-        {
-            if (assign_expr.var.token.lexeme == m_vars[ix].token.lexeme)
-            {
-                is_declared = true;
-                break;
-            }
-        }
-        if (!is_declared)
-        {
-            m_had_error = true;
-            error::report(
-                assign_expr.var.token.line,
-                "Undeclared variable '" + assign_expr.var.token.lexeme + "'"
-            );
-        }
-        analyze_expr(*expr.variant.assign.expr);
-        break;
+        m_had_error = true;
+        error::report(m_ast.token(name).offset, "Already defined variable");
     }
-    case ExprType::Unary:
+    if (m_frame_sizes.back() == 256)
     {
-        analyze_expr(*expr.variant.unary.expr);
-        break;
+        m_had_error = true;
+        error::report(
+            m_ast.token(name).offset,
+            "Limit of 256 local vars has been exceeded"
+        );
     }
-    case ExprType::Grouping:
+    return bind(m_ast.symbol(name));
+}
+
+Binding Analyzer::resolve(TokenRef name)
+{
+    Scoped const &current = scoped(m_ast.symbol(name));
+    if (current.scope_depth < 0)
     {
-        analyze_expr(*expr.variant.grouping.expr);
-        break;
+        m_had_error = true;
+        error::report(
+            m_ast.token(name).offset,
+            "Undeclared variable '" + std::string(m_ast.lexeme(name)) + "'"
+        );
     }
-    case ExprType::Call:
+    return current.binding;
+}
+
+void Analyzer::end_scope()
+{
+    while (!m_vars.empty() &&
+           m_bindings[m_vars.back().symbol].scope_depth >= m_scope_depth)
     {
-        // check if function exists
-        break;
+        m_bindings[m_vars.back().symbol] = m_vars.back().shadowed;
+        m_vars.pop_back();
+        m_frame_sizes.back()--;
     }
+    m_scope_depth--;
+}
+
+void Analyzer::enter(VarExpr const &expr, ExprRef ref)
+{
+    if (ref.bits == m_callee.bits)
+    {
+        // the tree is refilled in pipelined mode, which reuses the reference
+        m_callee = ExprRef();
+        return;
     }
+    m_ast.get<VarExpr>(ref).binding = resolve(expr.name);
 }
 
-void Analyzer::analyze_stmt(Stmt &stmt)
+void Analyzer::enter(AssignExpr const &expr, ExprRef ref)
 {
-    switch (stmt.kind)
+    m_ast.get<AssignExpr>(ref).binding = resolve(expr.name);
+}
+
+void Analyzer::enter(CallExpr const &expr, ExprRef)
+{
+    // check if function exists. The callee is visited right after this,
+    // before anything else can overwrite m_callee.
+    m_callee = expr.callee;
+}
+
+void Analyzer::leave(VarStmt const &stmt, StmtRef ref)
+{
+    // declared after the initializer, which still sees an outer variable
+    // of the same name
+    m_ast.get<VarStmt>(ref).var.binding = declare(stmt.var.token);
+}
+
+void Analyzer::enter(BlockStmt const &, StmtRef) { m_scope_depth++; }
+
+void Analyzer::leave(BlockStmt const &, StmtRef) { end_scope(); }
+
+void Analyzer::enter(FuncStmt const &stmt, StmtRef)
+{
+    m_scope_depth++;
+    m_frame_sizes.push_back(0);
+    for (TokenRef param : m_ast.params(stmt))
     {
-    case StmtType::Expr:
-        analyze_expr(*stmt.variant.expr.expr);
-        break;
-    case StmtType::Print:
-        analyze_expr(*stmt.variant.print.expr);
-        break;
-    case StmtType::Var:
-        for (int ix = m_vars.size() - 1; ix >= 0; --ix)
-        {
-            if (stmt.variant.var.var.token.lexeme == m_vars[ix].token.lexeme &&
-                m_vars[ix].scope_depth == m_scope_depth)
-            {
-                m_had_error = true;
-                error::report(
-                    stmt.variant.var.var.token.line, "Already defined variable"
-                );
-            }
-        }
-        m_vars.push_back(stmt.variant.var.var);
-        if (m_vars.size() > 256)
-        {
-            m_had_error = true;
-            error::report(
-                stmt.variant.var.var.token.line,
-                "Limit of 256 local vars has been exceeded"
-            );
-        }
-        break;
-    case StmtType::Block:
-        m_scope_depth++;
-        for (auto &stmt : stmt.variant.block.statements)
-        {
-            analyze_stmt(*stmt);
-        }
-        while (!m_vars.empty() && m_vars.back().scope_depth >= m_scope_depth)
-        {
-            m_vars.pop_back();
-        }
-        m_scope_depth--;
-        break;
-    case StmtType::If:
-        analyze_expr(*stmt.variant.if_.condition);
-
-        analyze_stmt(*stmt.variant.if_.then_branch);
-        if (stmt.variant.if_.else_branch != nullptr)
-        {
-            analyze_stmt(*stmt.variant.if_.else_branch);
-        }
-        break;
-    case StmtType::While:
-        analyze_expr(*stmt.variant.while_.condition);
-        analyze_stmt(*stmt.variant.while_.body);
-        break;
-    case StmtType::Func:
-        m_scope_depth++;
-
-        for (auto const &param : stmt.variant.func.params)
-        {
-            m_vars.push_back(LocalVar(param, m_scope_depth));
-        }
-
-        analyze_stmt(*stmt.variant.func.body);
-
-        while (!m_vars.empty() && m_vars.back().scope_depth >= m_scope_depth)
-        {
-            m_vars.pop_back();
-        }
-
-        m_scope_depth--;
-        break;
+        declare(param);
     }
 }
+
+void Analyzer::leave(FuncStmt const &, StmtRef)
+{
+    end_scope();
+    m_frame_sizes.pop_back();
+}
@@ -1,26 +1,91 @@
 #ifndef ANALYZER_HPP
 #define ANALYZER_HPP
 
+#include <cstdint>
+#include <span>
 #include <vector>
 
+#include "common/ast.hpp"
 #include "common/expression.hpp"
+#include "common/interner.hpp"
 #include "common/statements.hpp"
 
+// Resolves every variable reference to the declaration it names and writes
+// the Binding into the syntax tree, so later phases address variables by
+// slot instead of looking up names.
 class Analyzer
 {
    public:
-    Analyzer() : m_had_error(0), m_vars({}), m_scope_depth(0) {}
+    Analyzer(Ast &ast)
+        : m_ast(ast),
+          m_had_error(0),
+          m_vars({}),
+          m_bindings({}),
+          m_frame_sizes({0}),
+          m_scope_depth(0),
+          m_callee()
+    {
+    }
+    // Starts out with `globals` declared at the top level, as if by code
+    // preceding the tree, in order.
+    Analyzer(Ast &ast, std::span<common::Symbol const> globals);
     ~Analyzer() = default;
 
-    void analyze(std::vector<std::unique_ptr<Stmt>> &statements);
+    void analyze();
+    // Pipelined mode: resolves the statements the tree holds now, in the
+    // scope the previous call left behind. Errors are only reported, until
+    // finish() fails if there were any.
+    void analyze_next();
+    void finish();
+    bool had_error() const { return m_had_error; }
+
+    // The top-level variables in scope after analyze(), in slot order.
+    std::vector<common::Symbol> globals() const;
+
+    // traversal hooks, see walk()
+    void enter(VarExpr const &expr, ExprRef ref);
+    void enter(AssignExpr const &expr, ExprRef ref);
+    void enter(CallExpr const &expr, ExprRef ref);
+    void leave(VarStmt const &stmt, StmtRef ref);
+    void enter(BlockStmt const &stmt, StmtRef ref);
+    void leave(BlockStmt const &stmt, StmtRef ref);
+    void enter(FuncStmt const &stmt, StmtRef ref);
+    void leave(FuncStmt const &stmt, StmtRef ref);
 
    private:
-    void analyze_expr(Expr &expr);
-    void analyze_stmt(Stmt &stmt);
+    // The innermost declaration of a symbol in scope, depth -1 if none.
+    struct Scoped
+    {
+        Binding binding;
+        int scope_depth = -1;
+    };
+
+    // A variable in scope, with the declaration of the same name it
+    // shadows. Scopes end in reverse order, so the declarations of the
+    // innermost scope are always at the back.
+    struct Declaration
+    {
+        common::Symbol symbol;
+        Scoped shadowed;
+    };
+
+    Scoped &scoped(common::Symbol symbol);
+    Binding bind(common::Symbol symbol);
+    Binding declare(TokenRef name);
+    Binding resolve(TokenRef name);
+    void end_scope();
 
+    Ast &m_ast;
     bool m_had_error;
-    std::vector<LocalVar> m_vars;
+    std::vector<Declaration> m_vars;
+    // indexed by symbol
+    std::vector<Scoped> m_bindings;
+    // the number of live slots of each enclosing function's frame, the
+    // top level first
+    std::vector<uint32_t> m_frame_sizes;
     int m_scope_depth;
+    // names a function rather than a variable, so it is not resolved
+    ExprRef m_callee;
 };
 
 #endif
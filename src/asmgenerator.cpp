@@ -1,384 +1,508 @@
 #include "asmgenerator.hpp"
 
-#include <iostream>
-#include <sstream>
-#include <set>
+#include <algorithm>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
+#include "common/error.hpp"
 #include "common/irinstructions.hpp"
 
-std::string generate_assembly(
-    std::pair<
-        std::vector<std::unique_ptr<IRInstr>>,
-        std::unordered_map<std::string, IRFunction>> &ir
-)
+namespace
+{
+// An operand as spelled in the assembly, to write it inline.
+struct Spelled
+{
+    Operand operand;
+    common::Interner const &names;
+};
+
+common::Writer &operator<<(common::Writer &out, Spelled spelled)
+{
+    spelled.operand.print(out, spelled.names);
+    return out;
+}
+
+// An operand read for its value: an immediate, or the memory of a
+// variable or temporary.
+struct Read
 {
-    std::ostringstream oss;
+    Operand operand;
+    common::Interner const &names;
+};
 
-    oss << "section .data\n";
-    oss << "fmt: db \"%ld\", 10, 0\n";
-    std::set<std::string> vars;
-    for (auto &instr : ir.first)
+common::Writer &operator<<(common::Writer &out, Read read)
+{
+    if (read.operand.is_immediate())
+    {
+        return out << Spelled{read.operand, read.names};
+    }
+    return out << '[' << Spelled{read.operand, read.names} << ']';
+}
+
+// Calls `use` with every variable and temporary `func` reads or writes,
+// and with its parameters, which callers write even if it never reads them.
+template <typename Use>
+void for_each_storage(IRFunction const &func, Use use)
+{
+    auto visit = [&](Operand operand)
     {
-        switch (instr->kind)
+        if (operand.is_storage())
+        {
+            use(operand);
+        }
+    };
+
+    for (Operand param : func.params)
+    {
+        visit(param);
+    }
+
+    for (IRInstr const &instr : func.code)
+    {
+        switch (instr.kind)
         {
         case IRType::Assign:
-            vars.insert(instr->variant.assign.dst);
-            vars.insert(instr->variant.assign.src);
+            visit(instr.variant.assign.dst);
+            visit(instr.variant.assign.src);
             break;
         case IRType::BinaryOp:
-            vars.insert(instr->variant.binaryOp.dst);
-            vars.insert(instr->variant.binaryOp.left);
-            vars.insert(instr->variant.binaryOp.right);
+            visit(instr.variant.binaryOp.dst);
+            visit(instr.variant.binaryOp.left);
+            visit(instr.variant.binaryOp.right);
             break;
         case IRType::UnaryOp:
-            vars.insert(instr->variant.unaryOp.dst);
-            vars.insert(instr->variant.unaryOp.value);
+            visit(instr.variant.unaryOp.dst);
+            visit(instr.variant.unaryOp.value);
             break;
         case IRType::Goto:
             break;
         case IRType::IfFalseGoto:
-            vars.insert(instr->variant.ifFalseGoto.condition);
+            visit(instr.variant.ifFalseGoto.condition);
             break;
         case IRType::Label:
             break;
         case IRType::Print:
-            vars.insert(instr->variant.print.value);
+            visit(instr.variant.print.value);
             break;
         case IRType::Call:
-            vars.insert(instr->variant.call.dst);
-            for (auto const &arg : instr->variant.call.args)
+            if (!instr.variant.call.dst.is_none())
+            {
+                // where the result is read from
+                visit(Operand::temp(0));
+            }
+            visit(instr.variant.call.dst);
+            for (Operand arg : func.args(instr.variant.call))
             {
-                vars.insert(arg);
+                visit(arg);
             }
             break;
         case IRType::Return:
             break;
-        }
-    }
-    for (auto &func : ir.second)
-    {
-        for (auto &instr : func.second.body)
-        {
-            switch (instr->kind)
+        case IRType::Phi:
+            visit(instr.variant.phi.dst);
+            for (Operand arg : func.args(instr.variant.phi))
             {
-            case IRType::Assign:
-                vars.insert(instr->variant.assign.dst);
-                vars.insert(instr->variant.assign.src);
-                break;
-            case IRType::BinaryOp:
-                vars.insert(instr->variant.binaryOp.dst);
-                vars.insert(instr->variant.binaryOp.left);
-                vars.insert(instr->variant.binaryOp.right);
-                break;
-            case IRType::UnaryOp:
-                vars.insert(instr->variant.unaryOp.dst);
-                vars.insert(instr->variant.unaryOp.value);
-                break;
-            case IRType::Goto:
-                break;
-            case IRType::IfFalseGoto:
-                vars.insert(instr->variant.ifFalseGoto.condition);
-                break;
-            case IRType::Label:
-                break;
-            case IRType::Print:
-                vars.insert(instr->variant.print.value);
-                break;
-            case IRType::Call:
-                vars.insert(instr->variant.call.dst);
-                for (auto const &arg : instr->variant.call.args)
-                {
-                    vars.insert(arg);
-                }
-                break;
-            case IRType::Return:
-                break;
+                visit(arg);
             }
+            break;
+        case IRType::Nop:
+            break;
         }
     }
+}
 
-    for (auto const &var : vars)
+template <typename Use>
+void for_each_storage(IRProgram const &ir, Use use)
+{
+    for_each_storage(ir.main, use);
+    for (IRFunction const &func : ir.functions)
     {
-        if ((!var.empty() && var[0] == 't') || isalpha(var[0]))
-        {
-            oss << var << ": dq 0\n";
-        }
+        for_each_storage(func, use);
     }
+}
 
-    oss << "newline: db 10\n\n";
-    oss << "section .text\n";
-    oss << "extern printf\n";
-    oss << "global _start\n\n";
-
-    for (auto &func : ir.second)
-    {
-        for (auto &instr : func.second.body)
+// Marks the storage `ir` uses in `vars` and `temps`, indexed by ID, and
+// adds what was not marked before to `added`.
+void mark_storage(
+    IRProgram const &ir, std::vector<bool> &vars, std::vector<bool> &temps,
+    std::vector<Operand> &added
+)
+{
+    for_each_storage(
+        ir,
+        [&](Operand operand)
         {
-            switch (instr->kind)
-            {
-            case IRType::Assign:
+            auto &marks = operand.kind == OperandKind::Temp ? temps : vars;
+            if (operand.id >= marks.size())
             {
-                auto &a = instr->variant.assign;
-                if (isdigit(a.src[0]) || (a.src[0] == '-' && isdigit(a.src[1])))
-                {
-                    oss << "\tmov rax, " << a.src << "\n";
-                }
-                else
-                {
-                    oss << "\tmov rax, [" << a.src << "]\n";
-                }
-                oss << "\tmov [" << a.dst << "], rax\n";
-                break;
+                marks.resize(operand.id + 1);
             }
-            case IRType::BinaryOp:
+            if (!marks[operand.id])
             {
-                auto &a = instr->variant.binaryOp;
-
-                oss << "\tmov rax, [" << a.left << "]\n";
-                if (a.op == "==" || a.op == "!=" || a.op == "<" ||
-                    a.op == ">" || a.op == "<=" || a.op == ">=")
-                {
-                    oss << "\tcmp rax, [" << a.right << "]\n";
-                    if (a.op == "==")
-                        oss << "\tsete al\n";
-                    else if (a.op == "!=")
-                        oss << "\tsetne al\n";
-                    else if (a.op == "<")
-                        oss << "\tsetl al\n";
-                    else if (a.op == "<=")
-                        oss << "\tsetle al\n";
-                    else if (a.op == ">")
-                        oss << "\tsetg al\n";
-                    else if (a.op == ">=")
-                        oss << "\tsetge al\n";
-                    oss << "\tmovzx rax, al\n";
-                }
-                else if (a.op == "+")
-                {
-                    oss << "\tmov rbx, [" << a.right << "]\n";
-                    oss << "\tadd rax, rbx\n";
-                }
-                else if (a.op == "-")
-                {
-                    oss << "\tmov rbx, [" << a.right << "]\n";
-                    oss << "\tsub rax, rbx\n";
-                }
-                else if (a.op == "*")
-                {
-                    oss << "\tmov rbx, [" << a.right << "]\n";
-                    oss << "\timul rax, rbx\n";
-                }
-                else
-                {
-                    oss << "\t; unsupported binary op: " << a.op << "\n";
-                }
-
-                oss << "\tmov [" << a.dst << "], rax\n";
-                break;
+                marks[operand.id] = true;
+                added.push_back(operand);
             }
-            case IRType::UnaryOp:
-            {
-                auto &a = instr->variant.unaryOp;
-                oss << "\tmov rax, [" << a.value << "]\n";
-                if (a.op == "-")
-                {
-                    oss << "\tneg rax\n";
-                }
-                oss << "\tmov [" << a.dst << "], rax\n";
-                break;
-            }
-            case IRType::Goto:
-            {
-                auto &a = instr->variant.goto_;
-                oss << "\tjmp " << a.label << "\n";
-                break;
-            }
-            case IRType::IfFalseGoto:
-            {
-                auto &a = instr->variant.ifFalseGoto;
-                oss << "\tcmp qword [" << a.condition << "], 0\n";
-                oss << "\tje " << a.label << "\n";
-                break;
-            }
-            case IRType::Label:
-            {
-                auto &a = instr->variant.label;
-                oss << a.name << ":\n";
-                break;
-            }
-            case IRType::Print:
+        }
+    );
+}
+
+// Writes the `.data` entries of `storage`: the variables sorted by name,
+// then the temporaries by number.
+void declare(
+    std::vector<Operand> &storage, common::Interner const &names,
+    common::Writer &out
+)
+{
+    std::sort(
+        storage.begin(), storage.end(),
+        [&](Operand a, Operand b)
+        {
+            if (a.kind != b.kind)
             {
-                auto &a = instr->variant.print;
-                oss << "\tmov rdi, fmt\n";
-                oss << "\tmov rsi, [" << a.value << "]\n";
-                oss << "\txor rax, rax\n";
-                oss << "\tcall printf\n";
-                break;
+                return a.kind == OperandKind::Var;
             }
-            case IRType::Call:
-            {
-                auto &a = instr->variant.call;
-                auto &f = ir.second[a.funcName];
-
-                for (size_t i = 0; i < a.args.size(); ++i)
-                {
-                    oss << "\tmov rax, [" << a.args[i] << "]\n";
-                    oss << "\tmov [" << f.params[i] << "], rax\n";
-                }
+            return a.kind == OperandKind::Var
+                       ? names.name(a.id) < names.name(b.id)
+                       : a.id < b.id;
+        }
+    );
+    for (Operand operand : storage)
+    {
+        out << Spelled{operand, names} << ": dq 0\n";
+    }
+}
 
-                oss << "\tcall " << "func_" << a.funcName << "\n";
+// The storage of argument `ix` to `func` when its parameters are not known
+// yet, to be defined as an alias of them later on.
+void write_forward_param(
+    common::Writer &out, common::Interner const &names, Operand func,
+    size_t ix
+)
+{
+    out << Spelled{func, names} << ".arg" << ix;
+}
 
-                if (!a.dst.empty())
-                {
-                    oss << "\tmov rax, [t0]\n";
-                    oss << "\tmov [" << a.dst << "], rax\n";
-                }
-                break;
-            }
-            case IRType::Return:
-                oss << "\tret\n";
-                break;
-            }
-        }
-        oss << '\n';
+// The condition code of the set/jump instructions for a comparison.
+std::string_view condition_code(IROp op)
+{
+    switch (op)
+    {
+    case IROp::Equal:
+        return "e";
+    case IROp::NotEqual:
+        return "ne";
+    case IROp::Less:
+        return "l";
+    case IROp::LessEqual:
+        return "le";
+    case IROp::Greater:
+        return "g";
+    case IROp::GreaterEqual:
+        return "ge";
+    default:
+        error::unreachable();
+        return "";
     }
+}
 
-    oss << "_start:\n";
+// Writes the code of `func`. `param(callee, ix)` writes where argument
+// `ix` of a call to `callee` is to be stored.
+template <typename Param>
+void emit(
+    IRFunction const &func, common::Interner const &names,
+    common::Writer &out, Param param
+)
+{
+    auto name = [&](Operand operand) { return Spelled{operand, names}; };
+    auto read = [&](Operand operand) { return Read{operand, names}; };
 
-    for (auto &instr : ir.first)
+    for (IRInstr const &instr : func.code)
     {
-        switch (instr->kind)
+        switch (instr.kind)
         {
         case IRType::Assign:
         {
-            auto &a = instr->variant.assign;
-            if (isdigit(a.src[0]) || (a.src[0] == '-' && isdigit(a.src[1])))
-            {
-                oss << "\tmov rax, " << a.src << "\n";
-            }
-            else
-            {
-                oss << "\tmov rax, [" << a.src << "]\n";
-            }
-            oss << "\tmov [" << a.dst << "], rax\n";
+            auto &a = instr.variant.assign;
+            out << "\tmov rax, " << read(a.src) << "\n";
+            out << "\tmov [" << name(a.dst) << "], rax\n";
             break;
         }
         case IRType::BinaryOp:
         {
-            auto &a = instr->variant.binaryOp;
+            auto &a = instr.variant.binaryOp;
 
-            oss << "\tmov rax, [" << a.left << "]\n";
-            if (a.op == "==" || a.op == "!=" || a.op == "<" || a.op == ">" ||
-                a.op == "<=" || a.op == ">=")
-            {
-                oss << "\tcmp rax, [" << a.right << "]\n";
-                if (a.op == "==")
-                    oss << "\tsete al\n";
-                else if (a.op == "!=")
-                    oss << "\tsetne al\n";
-                else if (a.op == "<")
-                    oss << "\tsetl al\n";
-                else if (a.op == "<=")
-                    oss << "\tsetle al\n";
-                else if (a.op == ">")
-                    oss << "\tsetg al\n";
-                else if (a.op == ">=")
-                    oss << "\tsetge al\n";
-                oss << "\tmovzx rax, al\n";
-            }
-            else if (a.op == "+")
-            {
-                oss << "\tmov rbx, [" << a.right << "]\n";
-                oss << "\tadd rax, rbx\n";
-            }
-            else if (a.op == "-")
-            {
-                oss << "\tmov rbx, [" << a.right << "]\n";
-                oss << "\tsub rax, rbx\n";
-            }
-            else if (a.op == "*")
-            {
-                oss << "\tmov rbx, [" << a.right << "]\n";
-                oss << "\timul rax, rbx\n";
-            }
-            else
+            out << "\tmov rax, " << read(a.left) << "\n";
+            switch (a.op)
             {
-                oss << "\t; unsupported binary op: " << a.op << "\n";
+            case IROp::Equal:
+            case IROp::NotEqual:
+            case IROp::Less:
+            case IROp::LessEqual:
+            case IROp::Greater:
+            case IROp::GreaterEqual:
+                // cmp takes no immediates wider than 32 bits
+                if (a.right.kind == OperandKind::WideImm)
+                {
+                    out << "\tmov rbx, " << read(a.right) << "\n";
+                    out << "\tcmp rax, rbx\n";
+                }
+                else
+                {
+                    out << "\tcmp rax, " << read(a.right) << "\n";
+                }
+                out << "\tset" << condition_code(a.op) << " al\n";
+                out << "\tmovzx rax, al\n";
+                break;
+            case IROp::Add:
+                out << "\tmov rbx, " << read(a.right) << "\n";
+                out << "\tadd rax, rbx\n";
+                break;
+            case IROp::Sub:
+                out << "\tmov rbx, " << read(a.right) << "\n";
+                out << "\tsub rax, rbx\n";
+                break;
+            case IROp::Mul:
+                out << "\tmov rbx, " << read(a.right) << "\n";
+                out << "\timul rax, rbx\n";
+                break;
+            default:
+                out << "\t; unsupported binary op: " << IROp_to_lexeme(a.op)
+                    << "\n";
+                break;
             }
 
-            oss << "\tmov [" << a.dst << "], rax\n";
+            out << "\tmov [" << name(a.dst) << "], rax\n";
             break;
         }
         case IRType::UnaryOp:
         {
-            auto &a = instr->variant.unaryOp;
-            oss << "\tmov rax, [" << a.value << "]\n";
-            if (a.op == "-")
+            auto &a = instr.variant.unaryOp;
+            out << "\tmov rax, " << read(a.value) << "\n";
+            if (a.op == IROp::Neg)
             {
-                oss << "\tneg rax\n";
+                out << "\tneg rax\n";
             }
-            oss << "t\tmov [" << a.dst << "], rax\n";
+            out << "\tmov [" << name(a.dst) << "], rax\n";
             break;
         }
         case IRType::Goto:
         {
-            auto &a = instr->variant.goto_;
-            oss << "\tjmp " << a.label << "\n";
+            auto &a = instr.variant.goto_;
+            out << "\tjmp " << name(a.label) << "\n";
             break;
         }
         case IRType::IfFalseGoto:
         {
-            auto &a = instr->variant.ifFalseGoto;
-            oss << "\tcmp qword [" << a.condition << "], 0\n";
-            oss << "\tje " << a.label << "\n";
+            auto &a = instr.variant.ifFalseGoto;
+            if (a.condition.is_immediate())
+            {
+                if (a.condition.value(names) == 0)
+                {
+                    out << "\tjmp " << name(a.label) << "\n";
+                }
+                break;
+            }
+            out << "\tcmp qword [" << name(a.condition) << "], 0\n";
+            out << "\tje " << name(a.label) << "\n";
             break;
         }
         case IRType::Label:
         {
-            auto &a = instr->variant.label;
-            oss << a.name << ":\n";
+            auto &a = instr.variant.label;
+            out << name(a.name) << ":\n";
             break;
         }
         case IRType::Print:
         {
-            auto &a = instr->variant.print;
-            oss << "\tmov rdi, fmt\n";
-            oss << "\tmov rsi, [" << a.value << "]\n";
-            oss << "\txor rax, rax\n";
-            oss << "\tcall printf\n";
+            auto &a = instr.variant.print;
+            out << "\tmov rdi, fmt\n";
+            out << "\tmov rsi, " << read(a.value) << "\n";
+            out << "\txor rax, rax\n";
+            out << "\tcall printf\n";
             break;
         }
         case IRType::Call:
         {
-            auto &a = instr->variant.call;
-            auto &f = ir.second[a.funcName];
+            auto &a = instr.variant.call;
+            std::span<Operand const> args = func.args(a);
 
-            for (size_t i = 0; i < a.args.size(); ++i)
+            for (size_t i = 0; i < args.size(); ++i)
             {
-                oss << "\tmov rax, [" << a.args[i] << "]\n";
-                oss << "\tmov [" << f.params[i] << "], rax\n";
+                out << "\tmov rax, " << read(args[i]) << "\n";
+                out << "\tmov [";
+                param(a.func, i);
+                out << "], rax\n";
             }
 
-            oss << "\tcall " << "func_" << a.funcName << "\n";
+            out << "\tcall " << name(a.func) << "\n";
 
-            if (!a.dst.empty())
+            if (!a.dst.is_none())
             {
-                oss << "\tmov rax, [t0]\n";
-                oss << "\tmov [" << a.dst << "], rax\n";
+                out << "\tmov rax, [t0]\n";
+                out << "\tmov [" << name(a.dst) << "], rax\n";
             }
             break;
         }
         case IRType::Return:
-            oss << "\tret\n";
+            out << "\tret\n";
+            break;
+        case IRType::Phi:
+            // the optimizer leaves SSA form before code is generated
+            error::unreachable();
+            break;
+        case IRType::Nop:
             break;
         }
     }
+}
+
+void emit_exit(common::Writer &out)
+{
+    out << "\tmov rax, 60\n";
+    out << "\txor rdi, rdi\n";
+    out << "\tsyscall\n\n";
+    out << "\tsection .bss\n";
+    out << "\tbuffer resb 20\n";
+}
+}  // namespace
+
+void generate_assembly(
+    IRProgram const &ir, common::Interner const &names, common::Writer &out
+)
+{
+    out << "section .data\n";
+    out << "fmt: db \"%ld\", 10, 0\n";
 
-    oss << "\tmov rax, 60\n";
-    oss << "\txor rdi, rdi\n";
-    oss << "\tsyscall\n\n";
-    oss << "\tsection .bss\n";
-    oss << "\tbuffer resb 20\n";
+    // every variable and temporary an instruction reads or writes
+    std::vector<bool> vars;
+    std::vector<bool> temps;
+    std::vector<Operand> used;
+    mark_storage(ir, vars, temps, used);
+    declare(used, names, out);
 
-    return oss.str();
+    out << "newline: db 10\n\n";
+    out << "section .text\n";
+    out << "extern printf\n";
+    out << "global _start\n\n";
+
+    std::unordered_map<common::Symbol, IRFunction const *> functions;
+    for (IRFunction const &func : ir.functions)
+    {
+        functions[func.name] = &func;
+    }
+    auto param = [&](Operand func, size_t ix)
+    {
+        auto it = functions.find(func.id);
+        if (it != functions.end() && ix < it->second->params.size())
+        {
+            out << Spelled{it->second->params[ix], names};
+        }
+        else
+        {
+            // left undefined, which the assembler reports
+            write_forward_param(out, names, func, ix);
+        }
+    };
+
+    for (IRFunction const &func : ir.functions)
+    {
+        emit(func, names, out, param);
+        out << '\n';
+    }
+
+    out << "_start:\n";
+    emit(ir.main, names, out, param);
+    emit_exit(out);
 }
+
+AsmGenerator::AsmGenerator(common::Interner const &names, common::Writer &out)
+    : m_names(names), m_out(out), m_functions_section(false)
+{
+}
+
+void AsmGenerator::begin()
+{
+    m_out << "section .data\n";
+    m_out << "fmt: db \"%ld\", 10, 0\n";
+    m_out << "newline: db 10\n\n";
+    m_out << "section .text\n";
+    m_out << "extern printf\n";
+    m_out << "global _start\n\n";
+    m_out << "_start:\n";
+}
+
+void AsmGenerator::add(IRProgram const &ir)
+{
+    // the storage used for the first time
+    std::vector<Operand> added;
+    mark_storage(ir, m_declared_vars, m_declared_temps, added);
+    if (!added.empty())
+    {
+        m_out << "section .data\n";
+        declare(added, m_names, m_out);
+    }
+
+    for (IRFunction const &func : ir.functions)
+    {
+        m_params[func.name] = func.params;
+    }
+
+    auto param = [&](Operand func, size_t ix)
+    {
+        auto it = m_params.find(func.id);
+        if (it != m_params.end() && ix < it->second.size())
+        {
+            m_out << Spelled{it->second[ix], m_names};
+            return;
+        }
+        write_forward_param(m_out, m_names, func, ix);
+        size_t &count = m_forward[func.id];
+        count = std::max(count, ix + 1);
+    };
+
+    if (!ir.functions.empty())
+    {
+        m_out << "section .text.functions";
+        if (!m_functions_section)
+        {
+            m_out << " progbits alloc exec nowrite align=16";
+            m_functions_section = true;
+        }
+        m_out << '\n';
+
+        for (IRFunction const &func : ir.functions)
+        {
+            emit(func, m_names, m_out, param);
+            m_out << '\n';
+        }
+
+        for (IRFunction const &func : ir.functions)
+        {
+            auto forward = m_forward.find(func.name);
+            if (forward == m_forward.end())
+            {
+                continue;
+            }
+            auto const &params = func.params;
+            for (size_t ix = 0;
+                 ix < std::min(forward->second, params.size()); ++ix)
+            {
+                write_forward_param(
+                    m_out, m_names, Operand::func(func.name), ix
+                );
+                m_out << " equ " << Spelled{params[ix], m_names} << '\n';
+            }
+            m_forward.erase(forward);
+        }
+    }
+    if (!added.empty() || !ir.functions.empty())
+    {
+        m_out << "section .text\n";
+    }
+
+    emit(ir.main, m_names, m_out, param);
+}
+
+void AsmGenerator::finish() { emit_exit(m_out); }
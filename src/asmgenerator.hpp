@@ -1,19 +1,46 @@
 #ifndef ASMGENERATOR_HPP
 #define ASMGENERATOR_HPP
 
-#include <string>
-#include <vector>
-#include <memory>
+#include <cstddef>
 #include <unordered_map>
+#include <vector>
 
+#include "common/interner.hpp"
 #include "common/irinstructions.hpp"
+#include "common/output.hpp"
 #include "irgenerator.hpp"
 
-std::string generate_assembly(
-    std::pair<
-        std::vector<std::unique_ptr<IRInstr>>,
-        std::unordered_map<std::string, IRFunction>>
-        &ir
+// Writes the NASM assembly of a whole program to `out`.
+void generate_assembly(
+    IRProgram const &ir, common::Interner const &names, common::Writer &out
 );
 
+// Writes the assembly of a program one top-level declaration at a time, as
+// the pipelined mode lowers them. Main code goes to .text in source order,
+// functions to a section of their own so it never has to jump over them,
+// and the variables of every declaration to .data as they first show up.
+class AsmGenerator
+{
+   public:
+    AsmGenerator(common::Interner const &names, common::Writer &out);
+
+    void begin();
+    void add(IRProgram const &ir);
+    void finish();
+
+   private:
+    common::Interner const &m_names;
+    common::Writer &m_out;
+    // per variable symbol and temporary number, whether it has storage
+    std::vector<bool> m_declared_vars;
+    std::vector<bool> m_declared_temps;
+    bool m_functions_section;
+    // the parameter storage of the functions defined so far
+    std::unordered_map<common::Symbol, std::vector<Operand>> m_params;
+    // Functions called before their definition, with the most arguments
+    // passed. Those are stored through aliases, which are defined once the
+    // function is.
+    std::unordered_map<common::Symbol, size_t> m_forward;
+};
+
 #endif
@@ -0,0 +1,859 @@
+#include "cfg.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "common/irinstructions.hpp"
+
+CFG::CFG(IRFunction &func, IRContext &context)
+    : m_func(func),
+      m_context(context),
+      m_dom_valid(false),
+      m_post_dom_valid(false),
+      m_loops_valid(false)
+{
+    build();
+}
+
+// A block starts at every label and after every jump or return. The end
+// of the code gets a block of its own if control falls off it, so that
+// only returns and that block have no successors.
+void CFG::build()
+{
+    std::vector<IRInstr> code = std::move(m_func.code);
+    m_func.code.clear();
+
+    // a label at the very start could be jumped to, the entry can not
+    bool ends_block = !code.empty() && code[0].kind == IRType::Label &&
+                      code[0].variant.label.name.kind == OperandKind::Label;
+    m_blocks.emplace_back();
+    // the labels of one function are numbered close together
+    uint32_t first_label = UINT32_MAX;
+    uint32_t last_label = 0;
+    for (IRInstr const &instr : code)
+    {
+        if (instr.kind == IRType::Label &&
+            instr.variant.label.name.kind == OperandKind::Label)
+        {
+            first_label = std::min(first_label, instr.variant.label.name.id);
+            last_label = std::max(last_label, instr.variant.label.name.id);
+        }
+    }
+    std::vector<uint32_t> label_block(
+        first_label <= last_label ? last_label - first_label + 1 : 0, no_block
+    );
+    for (IRInstr const &instr : code)
+    {
+        if (instr.kind == IRType::Nop)
+        {
+            continue;
+        }
+        if (ends_block || (instr.kind == IRType::Label &&
+                           !m_blocks.back().code.empty()))
+        {
+            m_blocks.emplace_back();
+        }
+        if (instr.kind == IRType::Label &&
+            instr.variant.label.name.kind == OperandKind::Label)
+        {
+            label_block[instr.variant.label.name.id - first_label] =
+                static_cast<uint32_t>(m_blocks.size() - 1);
+        }
+        m_blocks.back().code.push_back(instr);
+        ends_block = instr.kind == IRType::Goto ||
+                     instr.kind == IRType::IfFalseGoto ||
+                     instr.kind == IRType::Return;
+    }
+    std::vector<IRInstr> const &last = m_blocks.back().code;
+    if (!last.empty() && last.back().kind != IRType::Goto &&
+        last.back().kind != IRType::Return)
+    {
+        m_blocks.emplace_back();
+    }
+
+    for (uint32_t ix = 0; ix < m_blocks.size(); ++ix)
+    {
+        m_layout.push_back(ix);
+        std::vector<IRInstr> &block = m_blocks[ix].code;
+        IRType last = block.empty() ? IRType::Nop : block.back().kind;
+        if (last == IRType::Goto)
+        {
+            uint32_t label = block.back().variant.goto_.label.id;
+            connect(ix, label_block[label - first_label], Operand());
+        }
+        else if (last == IRType::IfFalseGoto)
+        {
+            uint32_t target =
+                label_block[block.back().variant.ifFalseGoto.label.id -
+                            first_label];
+            // a branch to where control falls through anyway
+            if (target == ix + 1)
+            {
+                block.pop_back();
+            }
+            connect(ix, ix + 1, Operand());
+            if (target != ix + 1)
+            {
+                connect(ix, target, Operand());
+            }
+        }
+        else if (last != IRType::Return && ix + 1 < m_blocks.size())
+        {
+            connect(ix, ix + 1, Operand());
+        }
+    }
+}
+
+// The phis of `to` get `value` for the new edge.
+void CFG::connect(uint32_t from, uint32_t to, Operand value)
+{
+    m_blocks[from].succs.push_back(to);
+    m_blocks[to].preds.push_back(from);
+    for (IRInstr &instr : phis(to))
+    {
+        PhiIR &phi = instr.variant.phi;
+        std::span<Operand const> args = m_func.args(phi);
+        // a new copy at the end, as the next list may follow right after
+        std::vector<Operand> list(args.begin(), args.end());
+        list.push_back(value);
+        phi.first_arg = m_func.add_list(list);
+        ++phi.arg_count;
+    }
+}
+
+void CFG::disconnect(uint32_t from, uint32_t to)
+{
+    std::vector<uint32_t> &succs = m_blocks[from].succs;
+    succs.erase(std::find(succs.begin(), succs.end(), to));
+    std::vector<uint32_t> &preds = m_blocks[to].preds;
+    auto pred = std::find(preds.begin(), preds.end(), from);
+    size_t position = pred - preds.begin();
+    preds.erase(pred);
+    for (IRInstr &instr : phis(to))
+    {
+        PhiIR &phi = instr.variant.phi;
+        std::span<Operand> args = m_func.args(phi);
+        std::copy(
+            args.begin() + position + 1, args.end(), args.begin() + position
+        );
+        --phi.arg_count;
+    }
+}
+
+std::span<IRInstr> CFG::phis(uint32_t block)
+{
+    std::vector<IRInstr> &code = m_blocks[block].code;
+    size_t begin = 0;
+    while (begin < code.size() && code[begin].kind == IRType::Label)
+    {
+        ++begin;
+    }
+    size_t end = begin;
+    while (end < code.size() && code[end].kind == IRType::Phi)
+    {
+        ++end;
+    }
+    return std::span(code).subspan(begin, end - begin);
+}
+
+void CFG::invalidate()
+{
+    m_dom_valid = false;
+    m_post_dom_valid = false;
+    m_loops_valid = false;
+}
+
+uint32_t CFG::add_block(uint32_t before)
+{
+    uint32_t block = static_cast<uint32_t>(m_blocks.size());
+    m_blocks.emplace_back();
+    m_layout.insert(
+        std::find(m_layout.begin(), m_layout.end(), before), block
+    );
+    invalidate();
+    return block;
+}
+
+void CFG::add_edge(uint32_t from, uint32_t to)
+{
+    connect(from, to, Operand());
+    invalidate();
+}
+
+void CFG::redirect(uint32_t from, uint32_t to, uint32_t target)
+{
+    BasicBlock &block = m_blocks[from];
+    size_t position =
+        std::find(block.succs.begin(), block.succs.end(), to) -
+        block.succs.begin();
+    IRType last = block.code.empty() ? IRType::Nop : block.code.back().kind;
+    // what reached the phis of `target` through `to` now comes from `from`
+    std::vector<Operand> values;
+    std::vector<uint32_t> const &preds = m_blocks[target].preds;
+    auto through = std::find(preds.begin(), preds.end(), to);
+    for (IRInstr const &instr : phis(target))
+    {
+        values.push_back(
+            through == preds.end()
+                ? Operand()
+                : m_func.args(instr.variant.phi)[through - preds.begin()]
+        );
+    }
+    disconnect(from, to);
+    invalidate();
+
+    if (last == IRType::IfFalseGoto &&
+        std::find(block.succs.begin(), block.succs.end(), target) !=
+            block.succs.end())
+    {
+        // both ways lead to the same block now
+        m_blocks[from].code.pop_back();
+        return;
+    }
+
+    if (last == IRType::Goto)
+    {
+        m_blocks[from].code.back().variant.goto_.label = label(target);
+    }
+    else if (last == IRType::IfFalseGoto && position == 1)
+    {
+        m_blocks[from].code.back().variant.ifFalseGoto.label = label(target);
+    }
+    connect(from, target, Operand());
+    // back to where the edge was, the branch target stays second
+    std::vector<uint32_t> &succs = m_blocks[from].succs;
+    std::rotate(succs.begin() + position, succs.end() - 1, succs.end());
+    std::span<IRInstr> joins = phis(target);
+    for (size_t ix = 0; ix < joins.size(); ++ix)
+    {
+        m_func.args(joins[ix].variant.phi).back() = values[ix];
+    }
+}
+
+// The new block takes the place of `from` among the predecessors of `to`,
+// so the phis there need no change.
+uint32_t CFG::split_edge(uint32_t from, uint32_t to)
+{
+    uint32_t block = add_block(to);
+    BasicBlock &source = m_blocks[from];
+    size_t position =
+        std::find(source.succs.begin(), source.succs.end(), to) -
+        source.succs.begin();
+    IRType last = source.code.empty() ? IRType::Nop : source.code.back().kind;
+    if (last == IRType::Goto)
+    {
+        source.code.back().variant.goto_.label = label(block);
+    }
+    else if (last == IRType::IfFalseGoto && position == 1)
+    {
+        source.code.back().variant.ifFalseGoto.label = label(block);
+    }
+    m_blocks[from].succs[position] = block;
+    std::vector<uint32_t> &preds = m_blocks[to].preds;
+    *std::find(preds.begin(), preds.end(), from) = block;
+    m_blocks[block].preds.push_back(from);
+    m_blocks[block].succs.push_back(to);
+    return block;
+}
+
+uint32_t CFG::add_preheader(uint32_t header)
+{
+    std::vector<uint32_t> body = loops()[loop_of(header)].blocks;
+    std::vector<uint32_t> outside;
+    for (uint32_t pred : m_blocks[header].preds)
+    {
+        if (!std::binary_search(body.begin(), body.end(), pred))
+        {
+            outside.push_back(pred);
+        }
+    }
+    // per phi of the header, what it took from each of `outside`
+    std::vector<std::vector<Operand>> entering;
+    std::vector<uint32_t> const &preds = m_blocks[header].preds;
+    for (IRInstr const &instr : phis(header))
+    {
+        std::span<Operand const> args = m_func.args(instr.variant.phi);
+        std::vector<Operand> &values = entering.emplace_back();
+        for (uint32_t pred : outside)
+        {
+            values.push_back(
+                args[std::find(preds.begin(), preds.end(), pred) -
+                     preds.begin()]
+            );
+        }
+    }
+
+    uint32_t block = add_block(header);
+    for (uint32_t pred : outside)
+    {
+        redirect(pred, header, block);
+    }
+    add_edge(block, header);
+    std::vector<IRInstr> joins;
+    std::span<IRInstr> header_phis = phis(header);
+    for (size_t ix = 0; ix < header_phis.size(); ++ix)
+    {
+        std::vector<Operand> const &values = entering[ix];
+        Operand value = values[0];
+        if (std::find_if(
+                values.begin(), values.end(),
+                [&](Operand other) { return other != value; }
+            ) != values.end())
+        {
+            value = m_context.new_temp();
+            joins.push_back(PhiIR(
+                value, m_func.add_list(values),
+                static_cast<uint32_t>(values.size())
+            ));
+        }
+        m_func.args(header_phis[ix].variant.phi).back() = value;
+    }
+    // after the label the redirected jumps gave it, if any
+    std::vector<IRInstr> &code = m_blocks[block].code;
+    code.insert(code.end(), joins.begin(), joins.end());
+    return block;
+}
+
+void CFG::fold_branch(uint32_t block, bool taken)
+{
+    BasicBlock &b = m_blocks[block];
+    if (taken)
+    {
+        b.code.back() = GotoIR(b.code.back().variant.ifFalseGoto.label);
+        disconnect(block, b.succs[0]);
+    }
+    else
+    {
+        b.code.pop_back();
+        disconnect(block, b.succs[1]);
+    }
+    invalidate();
+}
+
+void CFG::remove_block(uint32_t block)
+{
+    BasicBlock &b = m_blocks[block];
+    while (!b.succs.empty())
+    {
+        disconnect(block, b.succs.back());
+    }
+    b.code.clear();
+    b.removed = true;
+    invalidate();
+}
+
+size_t CFG::remove_unreachable()
+{
+    compute_dominators();
+    std::vector<bool> reached(m_blocks.size());
+    for (uint32_t block : m_rpo)
+    {
+        reached[block] = true;
+    }
+    // only unreachable blocks lead to unreachable blocks, so dropping their
+    // edges first leaves none into the ones removed
+    std::vector<uint32_t> unreached;
+    for (uint32_t block = 0; block < m_blocks.size(); ++block)
+    {
+        if (!reached[block] && !m_blocks[block].removed)
+        {
+            unreached.push_back(block);
+            while (!m_blocks[block].succs.empty())
+            {
+                disconnect(block, m_blocks[block].succs.back());
+            }
+        }
+    }
+    for (uint32_t block : unreached)
+    {
+        remove_block(block);
+    }
+    return unreached.size();
+}
+
+Operand CFG::label(uint32_t block)
+{
+    std::vector<IRInstr> &code = m_blocks[block].code;
+    // the label of a function comes first, but is not jumped to
+    size_t at = !code.empty() && code[0].kind == IRType::Label &&
+                        code[0].variant.label.name.kind == OperandKind::Func
+                    ? 1
+                    : 0;
+    if (at < code.size() && code[at].kind == IRType::Label)
+    {
+        return code[at].variant.label.name;
+    }
+    Operand label = m_context.new_label();
+    code.insert(code.begin() + at, LabelIR(label));
+    return label;
+}
+
+void CFG::linearize()
+{
+    std::vector<uint32_t> layout;
+    for (uint32_t block : m_layout)
+    {
+        if (!m_blocks[block].removed)
+        {
+            layout.push_back(block);
+        }
+    }
+
+    // Blocks that no longer fall through to the next one get a jump, and
+    // those jumping to the next one fall through instead. The labels are
+    // added first, as that may change blocks laid out earlier.
+    std::vector<uint32_t> jump_to(layout.size(), no_block);
+    for (size_t ix = 0; ix < layout.size(); ++ix)
+    {
+        BasicBlock &block = m_blocks[layout[ix]];
+        std::erase_if(
+            block.code,
+            [](IRInstr const &instr) { return instr.kind == IRType::Nop; }
+        );
+        IRType last = block.code.empty() ? IRType::Nop : block.code.back().kind;
+        uint32_t next = ix + 1 < layout.size() ? layout[ix + 1] : no_block;
+        if (last == IRType::Goto && block.succs[0] == next)
+        {
+            block.code.pop_back();
+        }
+        else if (last != IRType::Goto && last != IRType::Return &&
+                 !block.succs.empty() && block.succs[0] != next)
+        {
+            jump_to[ix] = block.succs[0];
+            label(block.succs[0]);
+        }
+    }
+
+    m_func.code.clear();
+    for (size_t ix = 0; ix < layout.size(); ++ix)
+    {
+        std::vector<IRInstr> &code = m_blocks[layout[ix]].code;
+        m_func.code.insert(m_func.code.end(), code.begin(), code.end());
+        if (jump_to[ix] != no_block)
+        {
+            m_func.code.push_back(GotoIR(label(jump_to[ix])));
+        }
+    }
+
+    // and labels nothing jumps to go
+    std::unordered_set<uint32_t> targets;
+    for (IRInstr const &instr : m_func.code)
+    {
+        if (instr.kind == IRType::Goto)
+        {
+            targets.insert(instr.variant.goto_.label.id);
+        }
+        else if (instr.kind == IRType::IfFalseGoto)
+        {
+            targets.insert(instr.variant.ifFalseGoto.label.id);
+        }
+    }
+    std::erase_if(
+        m_func.code,
+        [&](IRInstr const &instr)
+        {
+            return instr.kind == IRType::Label &&
+                   instr.variant.label.name.kind == OperandKind::Label &&
+                   !targets.contains(instr.variant.label.name.id);
+        }
+    );
+}
+
+std::span<uint32_t const> CFG::reverse_postorder()
+{
+    compute_dominators();
+    return m_rpo;
+}
+
+uint32_t CFG::idom(uint32_t block)
+{
+    compute_dominators();
+    return m_dom.idom[block];
+}
+
+std::span<uint32_t const> CFG::dom_children(uint32_t block)
+{
+    compute_dominators();
+    return m_dom.children[block];
+}
+
+bool CFG::dominates(uint32_t a, uint32_t b)
+{
+    compute_dominators();
+    return m_dom.dominates(a, b);
+}
+
+uint32_t CFG::ipdom(uint32_t block)
+{
+    compute_post_dominators();
+    uint32_t ipdom = m_post_dom.idom[block];
+    // the virtual exit
+    return ipdom == m_blocks.size() ? no_block : ipdom;
+}
+
+bool CFG::post_dominates(uint32_t a, uint32_t b)
+{
+    compute_post_dominators();
+    return m_post_dom.dominates(a, b);
+}
+
+std::span<Loop const> CFG::loops()
+{
+    compute_loops();
+    return m_loops;
+}
+
+uint32_t CFG::loop_of(uint32_t block)
+{
+    compute_loops();
+    return m_loop_of[block];
+}
+
+// Postorder by an explicit depth-first search from `root`, following the
+// edges `next(node)` returns.
+template <typename Next>
+static std::vector<uint32_t> postorder(size_t size, uint32_t root, Next next)
+{
+    std::vector<uint32_t> order;
+    std::vector<bool> seen(size);
+    // node and the index of the next edge to follow
+    std::vector<std::pair<uint32_t, uint32_t>> stack = {{root, 0}};
+    seen[root] = true;
+    while (!stack.empty())
+    {
+        auto &[node, edge] = stack.back();
+        std::span<uint32_t const> edges = next(node);
+        if (edge < edges.size())
+        {
+            uint32_t to = edges[edge++];
+            if (!seen[to])
+            {
+                seen[to] = true;
+                stack.push_back({to, 0});
+            }
+            continue;
+        }
+        order.push_back(node);
+        stack.pop_back();
+    }
+    return order;
+}
+
+// The iterative algorithm of Cooper, Harvey and Kennedy: every node's
+// dominator is the common ancestor of those of its processed predecessors,
+// repeated in reverse postorder until nothing changes.
+template <typename Preds>
+static std::vector<uint32_t> immediate_dominators(
+    std::span<uint32_t const> order, size_t size, Preds preds
+)
+{
+    std::vector<uint32_t> number(size, UINT32_MAX);
+    for (uint32_t ix = 0; ix < order.size(); ++ix)
+    {
+        number[order[ix]] = ix;
+    }
+
+    std::vector<uint32_t> idom(size, no_block);
+    uint32_t root = order[0];
+    idom[root] = root;
+    auto intersect = [&](uint32_t a, uint32_t b)
+    {
+        while (a != b)
+        {
+            while (number[a] > number[b])
+            {
+                a = idom[a];
+            }
+            while (number[b] > number[a])
+            {
+                b = idom[b];
+            }
+        }
+        return a;
+    };
+
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        for (uint32_t node : order.subspan(1))
+        {
+            uint32_t dom = no_block;
+            for (uint32_t pred : preds(node))
+            {
+                if (idom[pred] == no_block)
+                {
+                    continue;
+                }
+                dom = dom == no_block ? pred : intersect(pred, dom);
+            }
+            if (idom[node] != dom)
+            {
+                idom[node] = dom;
+                changed = true;
+            }
+        }
+    }
+    idom[root] = no_block;
+    return idom;
+}
+
+void CFG::Tree::build(
+    std::span<uint32_t const> order, std::vector<uint32_t> idom_of
+)
+{
+    size_t size = idom_of.size();
+    idom = std::move(idom_of);
+    children.assign(size, {});
+    for (uint32_t node : order.subspan(1))
+    {
+        children[idom[node]].push_back(node);
+    }
+
+    enter.assign(size, UINT32_MAX);
+    leave.assign(size, 0);
+    uint32_t clock = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> stack = {{order[0], 0}};
+    enter[order[0]] = clock++;
+    while (!stack.empty())
+    {
+        auto &[node, child] = stack.back();
+        if (child < children[node].size())
+        {
+            uint32_t next = children[node][child++];
+            enter[next] = clock++;
+            stack.push_back({next, 0});
+            continue;
+        }
+        leave[node] = clock++;
+        stack.pop_back();
+    }
+}
+
+bool CFG::Tree::dominates(uint32_t a, uint32_t b) const
+{
+    return enter[b] != UINT32_MAX && enter[a] <= enter[b] &&
+           leave[b] <= leave[a];
+}
+
+void CFG::compute_dominators()
+{
+    if (m_dom_valid)
+    {
+        return;
+    }
+    m_dom_valid = true;
+
+    m_rpo = postorder(
+        m_blocks.size(), entry, [&](uint32_t block)
+        { return std::span<uint32_t const>(m_blocks[block].succs); }
+    );
+    std::reverse(m_rpo.begin(), m_rpo.end());
+    m_dom.build(
+        m_rpo, immediate_dominators(
+                   m_rpo, m_blocks.size(), [&](uint32_t block)
+                   { return std::span<uint32_t const>(m_blocks[block].preds); }
+               )
+    );
+}
+
+// Dominators of the reversed graph, rooted at a virtual exit numbered
+// m_blocks.size() that every block without successors leads to.
+void CFG::compute_post_dominators()
+{
+    if (m_post_dom_valid)
+    {
+        return;
+    }
+    m_post_dom_valid = true;
+
+    uint32_t exit = static_cast<uint32_t>(m_blocks.size());
+    std::vector<uint32_t> exits;
+    for (uint32_t ix = 0; ix < m_blocks.size(); ++ix)
+    {
+        if (!m_blocks[ix].removed && m_blocks[ix].succs.empty())
+        {
+            exits.push_back(ix);
+        }
+    }
+    // the reversed edges into the exit
+    std::vector<uint32_t> to_exit = {exit};
+
+    auto reversed_succs = [&](uint32_t block)
+    {
+        return block == exit ? std::span<uint32_t const>(exits)
+                             : std::span<uint32_t const>(m_blocks[block].preds);
+    };
+    auto reversed_preds = [&](uint32_t block)
+    {
+        if (block == exit)
+        {
+            return std::span<uint32_t const>();
+        }
+        return m_blocks[block].succs.empty()
+                   ? std::span<uint32_t const>(to_exit)
+                   : std::span<uint32_t const>(m_blocks[block].succs);
+    };
+
+    std::vector<uint32_t> order =
+        postorder(m_blocks.size() + 1, exit, reversed_succs);
+    std::reverse(order.begin(), order.end());
+    m_post_dom.build(
+        order, immediate_dominators(order, m_blocks.size() + 1, reversed_preds)
+    );
+}
+
+void CFG::compute_loops()
+{
+    if (m_loops_valid)
+    {
+        return;
+    }
+    m_loops_valid = true;
+    compute_dominators();
+
+    // an edge to a block that dominates its source closes a loop, whose
+    // body is found by walking back from there up to the header
+    m_loops.clear();
+    std::vector<uint32_t> in_body(m_blocks.size(), no_block);
+    for (uint32_t header : m_rpo)
+    {
+        Loop loop = {header, {header}, {}};
+        in_body[header] = header;
+        std::vector<uint32_t> work;
+        for (uint32_t pred : m_blocks[header].preds)
+        {
+            if (m_dom.dominates(header, pred))
+            {
+                loop.latches.push_back(pred);
+                work.push_back(pred);
+            }
+        }
+        if (loop.latches.empty())
+        {
+            continue;
+        }
+
+        while (!work.empty())
+        {
+            uint32_t block = work.back();
+            work.pop_back();
+            if (in_body[block] == header)
+            {
+                continue;
+            }
+            in_body[block] = header;
+            loop.blocks.push_back(block);
+            for (uint32_t pred : m_blocks[block].preds)
+            {
+                // unreachable blocks are in no loop
+                if (m_dom.enter[pred] != UINT32_MAX)
+                {
+                    work.push_back(pred);
+                }
+            }
+        }
+        std::sort(loop.blocks.begin(), loop.blocks.end());
+        m_loops.push_back(std::move(loop));
+    }
+
+    // Bigger loops first, so each loop finds its parent as the innermost
+    // loop its header was put in so far.
+    std::stable_sort(
+        m_loops.begin(), m_loops.end(), [](Loop const &a, Loop const &b)
+        { return a.blocks.size() > b.blocks.size(); }
+    );
+    m_loop_of.assign(m_blocks.size(), no_loop);
+    for (uint32_t ix = 0; ix < m_loops.size(); ++ix)
+    {
+        Loop &loop = m_loops[ix];
+        loop.parent = m_loop_of[loop.header];
+        loop.depth =
+            loop.parent == no_loop ? 1 : m_loops[loop.parent].depth + 1;
+        for (uint32_t block : loop.blocks)
+        {
+            m_loop_of[block] = ix;
+        }
+    }
+}
+
+void CFG::print_dot(common::Writer &out, common::Interner const &names)
+{
+    compute_loops();
+
+    out << "digraph \"";
+    if (m_func.name == common::no_symbol)
+    {
+        out << "main";
+    }
+    else
+    {
+        out << names.name(m_func.name);
+    }
+    out << "\" {\n";
+    out << "\tnode [shape=box, fontname=\"monospace\"];\n";
+
+    for (uint32_t block : m_layout)
+    {
+        if (m_blocks[block].removed)
+        {
+            continue;
+        }
+
+        out << "\tb" << block << " [label=\"b" << block;
+        uint32_t idom = m_dom.idom[block];
+        uint32_t ipdom = this->ipdom(block);
+        if (idom != no_block || ipdom != no_block)
+        {
+            out << " (";
+            if (idom != no_block)
+            {
+                out << "idom b" << idom << (ipdom != no_block ? ", " : "");
+            }
+            if (ipdom != no_block)
+            {
+                out << "ipdom b" << ipdom;
+            }
+            out << ')';
+        }
+        uint32_t loop = m_loop_of[block];
+        if (loop != no_loop && m_loops[loop].header == block)
+        {
+            out << " loop header, depth " << m_loops[loop].depth;
+        }
+        out << "\\l";
+        for (IRInstr const &instr : m_blocks[block].code)
+        {
+            m_func.print(out, names, instr);
+            out << "\\l";
+        }
+        out << '"';
+        if (loop != no_loop && m_loops[loop].header == block)
+        {
+            out << ", style=bold";
+        }
+        out << "];\n";
+
+        std::vector<uint32_t> const &succs = m_blocks[block].succs;
+        for (size_t ix = 0; ix < succs.size(); ++ix)
+        {
+            out << "\tb" << block << " -> b" << succs[ix];
+            if (succs.size() == 2)
+            {
+                out << (ix == 0 ? " [label=\"true\"" : " [label=\"false\"");
+                out << (m_dom.dominates(succs[ix], block) ? ", style=dashed]"
+                                                          : "]");
+            }
+            else if (m_dom.dominates(succs[ix], block))
+            {
+                out << " [style=dashed]";
+            }
+            out << ";\n";
+        }
+    }
+    out << "}\n";
+}
@@ -0,0 +1,163 @@
+#ifndef CFG_HPP
+#define CFG_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "common/interner.hpp"
+#include "common/irinstructions.hpp"
+#include "common/output.hpp"
+#include "irgenerator.hpp"
+
+inline constexpr uint32_t no_block = UINT32_MAX;
+inline constexpr uint32_t no_loop = UINT32_MAX;
+
+// A straight run of code that is only entered at its start and only left
+// at its end. It starts with its label, if it has one, and ends with its
+// jump or return, if any. Control falls through to succs[0] otherwise, and
+// also when the condition of a closing IfFalseGoto holds; succs[1] is the
+// target of that branch.
+struct BasicBlock
+{
+    std::vector<IRInstr> code;
+    std::vector<uint32_t> succs;
+    std::vector<uint32_t> preds;
+    bool removed = false;
+};
+
+// A natural loop: its header, and every block that reaches a back edge to
+// it without passing the header. Loops sharing a header are merged.
+struct Loop
+{
+    uint32_t header;
+    // sorted, including the header
+    std::vector<uint32_t> blocks;
+    // the sources of the back edges
+    std::vector<uint32_t> latches;
+    // the innermost enclosing loop
+    uint32_t parent = no_loop;
+    uint32_t depth = 1;
+};
+
+// The control-flow graph of a function, or of the top-level code. The code
+// is moved into the blocks on construction and put back in order by
+// linearize(). In between, passes edit the instructions of a block
+// freely, but change the edges only through the functions below, which
+// keep the jumps and both edge lists in sync. The dominator trees and
+// loops are not updated by these edits, which only mark them stale: they
+// are computed from scratch when next asked for. Phi arguments follow the
+// order of the predecessors through every edit.
+class CFG
+{
+   public:
+    static constexpr uint32_t entry = 0;
+
+    // New labels are numbered through `context`.
+    CFG(IRFunction &func, IRContext &context);
+
+    IRFunction &function() { return m_func; }
+    size_t size() const { return m_blocks.size(); }
+    BasicBlock &block(uint32_t ix) { return m_blocks[ix]; }
+    BasicBlock const &block(uint32_t ix) const { return m_blocks[ix]; }
+
+    // Adds an empty block without edges, laid out right before `before`.
+    uint32_t add_block(uint32_t before);
+    // Adds a fall-through edge to a block without successors. The phis of
+    // `to` get no value for it, which is up to the caller.
+    void add_edge(uint32_t from, uint32_t to);
+    // Makes the edge from `from` to `to` lead to `target` instead. The phis
+    // of `target` get the values they had for `to`, if that was one of its
+    // predecessors. A branch whose two edges then lead to the same block is
+    // dropped, for which the phis there must agree on both.
+    void redirect(uint32_t from, uint32_t to, uint32_t target);
+    // Puts a new block on the edge from `from` to `to` and returns it.
+    uint32_t split_edge(uint32_t from, uint32_t to);
+    // Leads the edges entering the loop headed by `header` from outside
+    // through a new block, laid out right before it, and returns that
+    // block. Phis there join the values the header took from outside.
+    uint32_t add_preheader(uint32_t header);
+    // Replaces the IfFalseGoto closing `block` by the way it always goes,
+    // the branch target if `taken`.
+    void fold_branch(uint32_t block, bool taken);
+    // Drops a block and its outgoing edges. No edges may lead to it.
+    void remove_block(uint32_t block);
+    // Drops the blocks the entry does not reach, returning how many.
+    size_t remove_unreachable();
+
+    // The phis of a block, which follow its labels.
+    std::span<IRInstr> phis(uint32_t block);
+
+    // Blocks reachable from the entry in reverse postorder.
+    std::span<uint32_t const> reverse_postorder();
+    // The immediate dominator, no_block for the entry and unreachable
+    // blocks.
+    uint32_t idom(uint32_t block);
+    std::span<uint32_t const> dom_children(uint32_t block);
+    bool dominates(uint32_t a, uint32_t b);
+    // The immediate post-dominator, no_block for blocks that leave the
+    // function and those that never do.
+    uint32_t ipdom(uint32_t block);
+    bool post_dominates(uint32_t a, uint32_t b);
+    // Outer loops come before the loops they contain.
+    std::span<Loop const> loops();
+    // The innermost loop containing `block`, or no_loop.
+    uint32_t loop_of(uint32_t block);
+
+    // The label starting `block`, which is added if it has none.
+    Operand label(uint32_t block);
+
+    // Writes the blocks back into the function in layout order, adding
+    // jumps where a block no longer falls through to the next one and
+    // dropping those to the next one, along with the labels nothing jumps
+    // to anymore.
+    void linearize();
+
+    // Writes the graph in Graphviz dot syntax, with the code of every
+    // block, its immediate dominator and post-dominator, loop headers
+    // marked and branch edges labeled.
+    void print_dot(common::Writer &out, common::Interner const &names);
+
+   private:
+    // A dominator tree, built from the immediate dominators of the nodes
+    // reachable from order[0], the root.
+    struct Tree
+    {
+        std::vector<uint32_t> idom;
+        std::vector<std::vector<uint32_t>> children;
+        // preorder interval of every node, for constant-time queries
+        std::vector<uint32_t> enter;
+        std::vector<uint32_t> leave;
+
+        void build(
+            std::span<uint32_t const> order, std::vector<uint32_t> idom_of
+        );
+        bool dominates(uint32_t a, uint32_t b) const;
+    };
+
+    void build();
+    void connect(uint32_t from, uint32_t to, Operand value);
+    void disconnect(uint32_t from, uint32_t to);
+    void invalidate();
+    void compute_dominators();
+    void compute_post_dominators();
+    void compute_loops();
+
+    IRFunction &m_func;
+    IRContext &m_context;
+    std::vector<BasicBlock> m_blocks;
+    std::vector<uint32_t> m_layout;
+
+    bool m_dom_valid;
+    bool m_post_dom_valid;
+    bool m_loops_valid;
+    std::vector<uint32_t> m_rpo;
+    Tree m_dom;
+    Tree m_post_dom;
+    std::vector<Loop> m_loops;
+    std::vector<uint32_t> m_loop_of;
+};
+
+#endif
@@ -0,0 +1,288 @@
+#include "cminus.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "analyzer.hpp"
+#include "asmgenerator.hpp"
+#include "cfg.hpp"
+#include "common/ast.hpp"
+#include "common/error.hpp"
+#include "common/interner.hpp"
+#include "common/output.hpp"
+#include "common/token.hpp"
+#include "frontend.hpp"
+#include "irgenerator.hpp"
+#include "lexer.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+#include "printer.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// Reports the time spent in a compilation phase when timing is enabled,
+// along with the throughput over the source text. Restarts the measurement.
+static void report_time(
+    common::Writer &out, bool enabled, char const *phase, size_t bytes,
+    Clock::time_point &since
+)
+{
+    auto now = Clock::now();
+    if (enabled)
+    {
+        double seconds = std::chrono::duration<double>(now - since).count();
+        char line[128];
+        int length = std::snprintf(
+            line, sizeof(line), "[time] %s: %g ms (%g MB/s)\n", phase,
+            seconds * 1e3, bytes / seconds / 1e6
+        );
+        out << std::string_view(line, length);
+    }
+    since = Clock::now();
+}
+
+// Reports what the optimizer did when timing is enabled.
+static void report_optimizer(
+    common::Writer &out, bool enabled, OptimizerStats const &stats
+)
+{
+    if (enabled)
+    {
+        char line[128];
+        int length = std::snprintf(
+            line, sizeof(line),
+            "[optimize] instructions: %zu -> %zu, dead code removed: %zu, "
+            "redundant removed: %zu, hoisted: %zu\n",
+            stats.instructions_before, stats.instructions_after, stats.dead,
+            stats.redundant, stats.hoisted
+        );
+        out << std::string_view(line, length);
+    }
+}
+
+static void print_ir(
+    IRProgram const &ir, common::Interner const &names, common::Writer &out
+)
+{
+    for (IRFunction const &func : ir.functions)
+    {
+        func.print(out, names);
+        out << '\n';
+    }
+    ir.main.print(out, names);
+}
+
+// Building a graph takes the code out of the function, so it is put back
+// after printing.
+static void print_cfg(IRProgram &ir, IRContext &context, common::Writer &out)
+{
+    for (IRFunction &func : ir.functions)
+    {
+        CFG cfg(func, context);
+        cfg.print_dot(out, context.names);
+        cfg.linearize();
+    }
+    CFG cfg(ir.main, context);
+    cfg.print_dot(out, context.names);
+    cfg.linearize();
+}
+
+// Runs every phase on one top-level declaration before reading the next,
+// see Options::pipelined. After the first error no more code is generated,
+// but the rest of the input is still checked for more.
+static void compile_pipelined(
+    std::string_view source, cminus::Options const &options,
+    common::Interner &interner, common::Writer &assembly, common::Writer &out
+)
+{
+    Lexer lexer(source, interner);
+    Parser parser(lexer, source);
+    Analyzer analyzer(parser.ast());
+    IRGenerator generator(parser.ast(), interner);
+    AsmGenerator asm_generator(interner, assembly);
+    OptimizerStats stats;
+
+    asm_generator.begin();
+    while (parser.parse_next())
+    {
+        if (options.emit_ast)
+        {
+            Printer printer(parser.ast(), out);
+            printer.print();
+        }
+        if (parser.had_error())
+        {
+            continue;
+        }
+
+        analyzer.analyze_next();
+        if (analyzer.had_error())
+        {
+            continue;
+        }
+
+        IRProgram ir = generator.generate();
+        if (options.optimize)
+        {
+            optimize(ir, generator.context(), false, stats);
+        }
+        if (options.emit_ir)
+        {
+            print_ir(ir, interner, out);
+        }
+        if (options.emit_cfg)
+        {
+            print_cfg(ir, generator.context(), out);
+        }
+        asm_generator.add(ir);
+    }
+    analyzer.finish();
+    asm_generator.finish();
+    if (options.optimize)
+    {
+        report_optimizer(out, options.timing, stats);
+    }
+
+    if (options.emit_ast || options.emit_ir || options.emit_cfg)
+    {
+        out << "\n\n";
+    }
+}
+
+bool cminus::compile(
+    std::string_view source, Options const &options, Output &output
+)
+{
+    output.assembly.clear();
+    bool compiled;
+    {
+        common::Writer assembly(output.assembly);
+        compiled = compile(source, options, assembly, output);
+    }
+    if (!compiled)
+    {
+        output.assembly.clear();
+    }
+    return compiled;
+}
+
+bool cminus::compile(
+    std::string_view source, Options const &options, common::Writer &assembly,
+    Output &output
+)
+{
+    output.diagnostics.clear();
+    output.dump.clear();
+
+    // both flush into `output` when they go away
+    error::DiagnosticEngine diagnostics(output.diagnostics, options.max_errors);
+    diagnostics.set_source(source);
+    common::Writer out(output.dump);
+
+    try
+    {
+        // keeps UINT32_MAX free for error::no_offset
+        if (source.size() >= UINT32_MAX)
+        {
+            error::fatal("Sources of 4 GiB and more are not supported");
+        }
+
+        size_t size = source.size();
+        bool timing = options.timing;
+        auto since = Clock::now();
+
+        common::Interner interner;
+        if (options.pipelined && !options.emit_tokens)
+        {
+            compile_pipelined(source, options, interner, assembly, out);
+            report_time(out, timing, "compile", size, since);
+            return true;
+        }
+
+        Ast ast(source);
+        // tokens are only ever held all at once by the serial front end
+        if (options.jobs > 1 && !options.emit_tokens)
+        {
+            ast = parse_parallel(source, interner, options.jobs);
+            report_time(out, timing, "lex + parse", size, since);
+        }
+        else if (options.streaming && !options.emit_tokens)
+        {
+            Lexer lexer(source, interner);
+            Parser parser(lexer, source);
+            ast = parser.parse();
+            report_time(out, timing, "lex + parse", size, since);
+        }
+        else
+        {
+            Lexer lexer(source, interner);
+            std::vector<Token> tokens = lexer.lex();
+            report_time(out, timing, "lex", size, since);
+
+            if (options.emit_tokens)
+            {
+                out << '\n';
+                for (Token const &token : tokens)
+                {
+                    token.print(out, source);
+                }
+                out << '\n';
+                report_time(out, timing, "print tokens", size, since);
+            }
+
+            Parser parser(std::move(tokens), source);
+            ast = parser.parse();
+            report_time(out, timing, "parse", size, since);
+        }
+
+        if (options.emit_ast)
+        {
+            Printer printer(ast, out);
+            printer.print();
+            out << "\n\n";
+            report_time(out, timing, "print ast", size, since);
+        }
+
+        Analyzer analyzer(ast);
+        analyzer.analyze();
+        report_time(out, timing, "analyze", size, since);
+
+        IRGenerator generator(ast, interner);
+        auto ir = generator.generate();
+
+        // the syntax tree is not needed anymore
+        ast = Ast(source);
+        report_time(out, timing, "generate ir", size, since);
+        if (options.optimize)
+        {
+            OptimizerStats stats;
+            optimize(ir, generator.context(), true, stats);
+            report_time(out, timing, "optimize", size, since);
+            report_optimizer(out, timing, stats);
+        }
+        if (options.emit_ir)
+        {
+            print_ir(ir, interner, out);
+            out << "\n\n";
+            report_time(out, timing, "print ir", size, since);
+        }
+        if (options.emit_cfg)
+        {
+            print_cfg(ir, generator.context(), out);
+            out << '\n';
+            report_time(out, timing, "print cfg", size, since);
+        }
+
+        generate_assembly(ir, interner, assembly);
+        report_time(out, timing, "generate asm", size, since);
+    }
+    catch (error::Fatal const &)
+    {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef CMINUS_HPP
+#define CMINUS_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "common/error.hpp"
+#include "common/output.hpp"
+
+// The compiler as a library, built into libcminus.a. Every call works on
+// its own state only, so any number of compilations can run at once on
+// different threads.
+namespace cminus
+{
+struct Options
+{
+    // stages whose output is dumped to Output::dump
+    bool emit_tokens = false;
+    bool emit_ast = false;
+    bool emit_ir = false;
+    // the control-flow graph of every function, in Graphviz dot syntax
+    bool emit_cfg = false;
+    // runs the optimizer on the IR before generating assembly
+    bool optimize = false;
+    // adds the time spent in every phase to Output::dump, and what the
+    // optimizer did
+    bool timing = false;
+    // front end to use, the parallel one if jobs > 1
+    bool streaming = false;
+    unsigned jobs = 1;
+    // Compiles one top-level declaration at a time, from parsing to writing
+    // its assembly, and frees its tree and IR before reading the next one.
+    // Memory then grows with the largest declaration rather than the whole
+    // program, except for the names and scopes, which are kept throughout.
+    // Dumps are written per declaration; dumping the tokens falls back to
+    // compiling the program as a whole.
+    bool pipelined = false;
+    // located diagnostics to report at most, 0 for all of them
+    size_t max_errors = error::DiagnosticEngine::default_limit;
+};
+
+// Caller owned buffers for the results. They are cleared by compile() but
+// keep their capacity, so reusing one per thread saves reallocating them.
+struct Output
+{
+    std::string assembly;
+    std::string diagnostics;
+    std::string dump;
+};
+
+// Compiles `source` to NASM assembly. Returns whether that succeeded; if
+// not, the reasons are in `output.diagnostics` and there is no assembly.
+bool compile(std::string_view source, Options const &options, Output &output);
+// Same, but writes the assembly to `assembly` as it is generated, leaving
+// `output.assembly` alone. Should this fail, what has been written is
+// incomplete and to be thrown away.
+bool compile(
+    std::string_view source, Options const &options, common::Writer &assembly,
+    Output &output
+);
+}  // namespace cminus
+
+#endif
@@ -0,0 +1,246 @@
+#include "ast.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+// Where the nodes, tokens and list entries of an appended tree end up.
+struct Rebase
+{
+    std::array<uint32_t, 8> exprs = {};
+    std::array<uint32_t, 8> stmts = {};
+    uint32_t tokens = 0;
+    uint32_t expr_lists = 0;
+    uint32_t stmt_lists = 0;
+    uint32_t token_lists = 0;
+
+    ExprRef operator()(ExprRef ref) const
+    {
+        if (ref.is_none())
+        {
+            return ref;
+        }
+        auto kind = static_cast<uint8_t>(ref.kind());
+        return ExprRef(ref.kind(), ref.index() + exprs[kind]);
+    }
+
+    StmtRef operator()(StmtRef ref) const
+    {
+        if (ref.is_none())
+        {
+            return ref;
+        }
+        auto kind = static_cast<uint8_t>(ref.kind());
+        return StmtRef(ref.kind(), ref.index() + stmts[kind]);
+    }
+};
+
+void rebase(BinaryExpr &node, Rebase const &by)
+{
+    node.left = by(node.left);
+    node.right = by(node.right);
+}
+void rebase(LiteralExpr &, Rebase const &) {}
+void rebase(VarExpr &node, Rebase const &by) { node.name += by.tokens; }
+void rebase(AssignExpr &node, Rebase const &by)
+{
+    node.name += by.tokens;
+    node.expr = by(node.expr);
+}
+void rebase(UnaryExpr &node, Rebase const &by) { node.expr = by(node.expr); }
+void rebase(GroupingExpr &node, Rebase const &by)
+{
+    node.expr = by(node.expr);
+}
+void rebase(CallExpr &node, Rebase const &by)
+{
+    node.callee = by(node.callee);
+    node.first_arg += by.expr_lists;
+}
+void rebase(ExprStmt &node, Rebase const &by) { node.expr = by(node.expr); }
+void rebase(PrintStmt &node, Rebase const &by) { node.expr = by(node.expr); }
+void rebase(VarStmt &node, Rebase const &by)
+{
+    node.var.token += by.tokens;
+    node.expr = by(node.expr);
+}
+void rebase(BlockStmt &node, Rebase const &by) { node.first += by.stmt_lists; }
+void rebase(IfStmt &node, Rebase const &by)
+{
+    node.condition = by(node.condition);
+    node.then_branch = by(node.then_branch);
+    node.else_branch = by(node.else_branch);
+}
+void rebase(WhileStmt &node, Rebase const &by)
+{
+    node.condition = by(node.condition);
+    node.body = by(node.body);
+}
+void rebase(FuncStmt &node, Rebase const &by)
+{
+    node.name += by.tokens;
+    node.first_param += by.token_lists;
+    node.body = by(node.body);
+}
+}  // namespace
+
+Ast::Ast(std::string_view source) : source(source) {}
+
+void Ast::clear()
+{
+    tokens.clear();
+    expr_lists.clear();
+    stmt_lists.clear();
+    token_lists.clear();
+    statements.clear();
+    std::apply([](auto &...arrays) { (arrays.clear(), ...); }, m_exprs);
+    std::apply([](auto &...arrays) { (arrays.clear(), ...); }, m_stmts);
+}
+
+void Ast::append(std::span<Ast const> trees)
+{
+    // where each tree's arrays start once everything has been appended
+    std::vector<Rebase> bases(trees.size());
+    Rebase next;
+    auto count = [](auto &offsets, auto const &...arrays)
+    {
+        ((offsets[static_cast<uint8_t>(
+              std::remove_cvref_t<decltype(arrays)>::value_type::kind
+          )] += arrays.size()),
+         ...);
+    };
+    auto advance = [&](Ast const &tree)
+    {
+        std::apply(
+            [&](auto const &...arrays) { count(next.exprs, arrays...); },
+            tree.m_exprs
+        );
+        std::apply(
+            [&](auto const &...arrays) { count(next.stmts, arrays...); },
+            tree.m_stmts
+        );
+        next.tokens += tree.tokens.size();
+        next.expr_lists += tree.expr_lists.size();
+        next.stmt_lists += tree.stmt_lists.size();
+        next.token_lists += tree.token_lists.size();
+    };
+    advance(*this);
+    for (size_t ix = 0; ix < trees.size(); ++ix)
+    {
+        bases[ix] = next;
+        advance(trees[ix]);
+    }
+
+    // grow every array once, then fill in the trees' parts
+    auto grow = [](auto const &sizes, auto &...arrays)
+    {
+        (arrays.resize(sizes[static_cast<uint8_t>(
+             std::remove_cvref_t<decltype(arrays)>::value_type::kind
+         )]),
+         ...);
+    };
+    std::apply([&](auto &...arrays) { grow(next.exprs, arrays...); }, m_exprs);
+    std::apply([&](auto &...arrays) { grow(next.stmts, arrays...); }, m_stmts);
+    tokens.resize(next.tokens);
+    expr_lists.resize(next.expr_lists);
+    stmt_lists.resize(next.stmt_lists);
+    token_lists.resize(next.token_lists);
+
+    for (size_t ix = 0; ix < trees.size(); ++ix)
+    {
+        Ast const &tree = trees[ix];
+        Rebase const &by = bases[ix];
+        auto copy = [&](auto const &...arrays)
+        {
+            auto copy_one = [&](auto const &theirs)
+            {
+                using Node = std::remove_cvref_t<decltype(theirs)>::value_type;
+                auto const &base = is_expr<Node> ? by.exprs : by.stmts;
+                Node *out = nodes<Node>().data() +
+                            base[static_cast<uint8_t>(Node::kind)];
+                for (Node node : theirs)
+                {
+                    rebase(node, by);
+                    *out++ = node;
+                }
+            };
+            (copy_one(arrays), ...);
+        };
+        std::apply(copy, tree.m_exprs);
+        std::apply(copy, tree.m_stmts);
+
+        std::copy(
+            tree.tokens.begin(), tree.tokens.end(), tokens.begin() + by.tokens
+        );
+        for (size_t jx = 0; jx < tree.expr_lists.size(); ++jx)
+        {
+            expr_lists[by.expr_lists + jx] = by(tree.expr_lists[jx]);
+        }
+        for (size_t jx = 0; jx < tree.stmt_lists.size(); ++jx)
+        {
+            stmt_lists[by.stmt_lists + jx] = by(tree.stmt_lists[jx]);
+        }
+        for (size_t jx = 0; jx < tree.token_lists.size(); ++jx)
+        {
+            token_lists[by.token_lists + jx] =
+                tree.token_lists[jx] + by.tokens;
+        }
+        for (StmtRef ref : tree.statements)
+        {
+            statements.push_back(by(ref));
+        }
+    }
+}
+
+TokenRef Ast::add_token(Token const &token)
+{
+    tokens.push_back(token);
+    return tokens.size() - 1;
+}
+
+std::string_view Ast::lexeme(TokenRef ref) const
+{
+    return tokens[ref].lexeme(source);
+}
+
+uint32_t Ast::add_list(std::span<ExprRef const> list)
+{
+    uint32_t first = expr_lists.size();
+    expr_lists.insert(expr_lists.end(), list.begin(), list.end());
+    return first;
+}
+
+uint32_t Ast::add_list(std::span<StmtRef const> list)
+{
+    uint32_t first = stmt_lists.size();
+    stmt_lists.insert(stmt_lists.end(), list.begin(), list.end());
+    return first;
+}
+
+uint32_t Ast::add_list(std::span<TokenRef const> list)
+{
+    uint32_t first = token_lists.size();
+    token_lists.insert(token_lists.end(), list.begin(), list.end());
+    return first;
+}
+
+std::span<ExprRef const> Ast::args(CallExpr const &call) const
+{
+    return std::span(expr_lists).subspan(call.first_arg, call.arg_count);
+}
+
+std::span<StmtRef const> Ast::children(BlockStmt const &block) const
+{
+    return std::span(stmt_lists).subspan(block.first, block.count);
+}
+
+std::span<TokenRef const> Ast::params(FuncStmt const &func) const
+{
+    return std::span(token_lists).subspan(func.first_param, func.param_count);
+}
@@ -0,0 +1,118 @@
+#ifndef COMMON_AST_HPP
+#define COMMON_AST_HPP
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "expression.hpp"
+#include "interner.hpp"
+#include "statements.hpp"
+#include "token.hpp"
+
+// A syntax tree in flat form. Nodes are stored by value in one array per
+// node kind and refer to each other, and to the tokens they name, by 32 bit
+// index. Variable length children (call arguments, block statements and
+// function parameters) are runs of consecutive entries in the *_lists
+// arrays. Freeing a tree is a handful of vector deallocations, whatever its
+// size.
+class Ast
+{
+    template <typename Node>
+    static constexpr bool is_expr = std::is_same_v<
+        std::remove_cv_t<decltype(Node::kind)>, ExprType>;
+
+    template <typename Node>
+    using ref_type = std::conditional_t<is_expr<Node>, ExprRef, StmtRef>;
+
+   public:
+    Ast(std::string_view source);
+
+    // the text all tokens point into
+    std::string_view source;
+    // only the tokens nodes refer to, i.e. names and their locations
+    std::vector<Token> tokens;
+    std::vector<ExprRef> expr_lists;
+    std::vector<StmtRef> stmt_lists;
+    std::vector<TokenRef> token_lists;
+    // the top-level statements, in source order
+    std::vector<StmtRef> statements;
+
+    template <typename Node>
+    auto add(Node const &node)
+    {
+        auto &array = nodes<Node>();
+        array.push_back(node);
+        return ref_type<Node>(Node::kind, array.size() - 1);
+    }
+
+    template <typename Node>
+    Node &get(ref_type<Node> ref)
+    {
+        return nodes<Node>()[ref.index()];
+    }
+
+    template <typename Node>
+    Node const &get(ref_type<Node> ref) const
+    {
+        return const_cast<Ast *>(this)->nodes<Node>()[ref.index()];
+    }
+
+    template <typename Node>
+    size_t count() const
+    {
+        return const_cast<Ast *>(this)->nodes<Node>().size();
+    }
+
+    // Copies the nodes of `trees` behind those of this tree, rebasing the
+    // handles they hold, and appends their top-level statements in order.
+    // Used to join trees parsed from consecutive parts of the same source.
+    void append(std::span<Ast const> trees);
+    // Removes every node, token and statement but keeps the memory, so the
+    // tree can be refilled without allocating again.
+    void clear();
+
+    TokenRef add_token(Token const &token);
+    Token const &token(TokenRef ref) const { return tokens[ref]; }
+    common::Symbol symbol(TokenRef ref) const { return tokens[ref].value; }
+    std::string_view lexeme(TokenRef ref) const;
+
+    uint32_t add_list(std::span<ExprRef const> list);
+    uint32_t add_list(std::span<StmtRef const> list);
+    uint32_t add_list(std::span<TokenRef const> list);
+
+    std::span<ExprRef const> args(CallExpr const &call) const;
+    std::span<StmtRef const> children(BlockStmt const &block) const;
+    std::span<TokenRef const> params(FuncStmt const &func) const;
+
+   private:
+    std::tuple<
+        std::vector<BinaryExpr>, std::vector<LiteralExpr>,
+        std::vector<VarExpr>, std::vector<AssignExpr>,
+        std::vector<UnaryExpr>, std::vector<GroupingExpr>,
+        std::vector<CallExpr>>
+        m_exprs;
+    std::tuple<
+        std::vector<ExprStmt>, std::vector<PrintStmt>, std::vector<VarStmt>,
+        std::vector<BlockStmt>, std::vector<IfStmt>, std::vector<WhileStmt>,
+        std::vector<FuncStmt>>
+        m_stmts;
+
+    template <typename Node>
+    std::vector<Node> &nodes()
+    {
+        if constexpr (is_expr<Node>)
+        {
+            return std::get<std::vector<Node>>(m_exprs);
+        }
+        else
+        {
+            return std::get<std::vector<Node>>(m_stmts);
+        }
+    }
+};
+
+#endif
@@ -5,7 +5,6 @@
 
 namespace common
 {
-std::string read_file(std::string const &path);
 void write_file(std::string const &path, std::string const &code);
 }  // namespace common
 
@@ -1,50 +1,172 @@
 #include "error.hpp"
 
-#include <iostream>
 #include <boost/stacktrace.hpp>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
 
 // TODO: is this really the best way?
 #define RESET "\033[0m"
 #define MAGENTA "\033[35m"
 #define RED "\033[31m"
 
-error::Fatal::Fatal(std::string message) { report(-1, message); }
+static thread_local bool silent = false;
+static thread_local std::vector<error::Diagnostic> *captured = nullptr;
+static thread_local error::DiagnosticEngine *engine = nullptr;
+
+// Formats a diagnostic located at `line`, which is 0 if it is unknown.
+static void format(
+    std::string &out, uint32_t offset, uint32_t line, std::string_view message
+)
+{
+    out += MAGENTA;
+    if (offset == error::no_offset)
+    {
+        out += "[Fatal error] ";
+    }
+    else if (line == 0)
+    {
+        out += "[offset " + std::to_string(offset) + "] ";
+    }
+    else
+    {
+        out += "[line " + std::to_string(line) + "] ";
+    }
+    out += RED;
+    out += message;
+    out += RESET;
+    out += '\n';
+}
+
+error::Silence::Silence() : m_was_silent(silent) { silent = true; }
+
+error::Silence::~Silence() { silent = m_was_silent; }
+
+error::Capture::Capture(std::vector<Diagnostic> &into) : m_previous(captured)
+{
+    captured = &into;
+}
+
+error::Capture::~Capture() { captured = m_previous; }
+
+error::DiagnosticEngine::DiagnosticEngine(std::ostream &out, size_t limit)
+    : m_stream(&out),
+      m_text(nullptr),
+      m_limit(limit),
+      m_located(0),
+      m_previous(engine)
+{
+    engine = this;
+}
+
+error::DiagnosticEngine::DiagnosticEngine(std::string &out, size_t limit)
+    : m_stream(nullptr),
+      m_text(&out),
+      m_limit(limit),
+      m_located(0),
+      m_previous(engine)
+{
+    engine = this;
+}
+
+void error::DiagnosticEngine::set_source(std::string_view source)
+{
+    m_source = source;
+    m_lines = common::LineIndex();
+}
+
+error::DiagnosticEngine::~DiagnosticEngine()
+{
+    flush();
+    engine = m_previous;
+}
 
-error::Synchronize::Synchronize(int line, std::string message)
+void error::DiagnosticEngine::add(uint32_t offset, std::string message)
 {
-    report(line, message);
+    if (offset != no_offset)
+    {
+        if (full())
+        {
+            return;
+        }
+        m_located++;
+    }
+
+    m_diagnostics.push_back({offset, std::move(message)});
+    if (offset != no_offset && full())
+    {
+        m_diagnostics.push_back(
+            {no_offset,
+             "Too many errors, stopped after " + std::to_string(m_limit)}
+        );
+    }
+}
+
+void error::DiagnosticEngine::flush()
+{
+    std::string out;
+    for (Diagnostic const &diagnostic : m_diagnostics)
+    {
+        uint32_t line = 0;
+        if (m_source.data() != nullptr && diagnostic.offset != no_offset)
+        {
+            line = m_lines.decode(m_source, diagnostic.offset).line;
+        }
+        format(out, diagnostic.offset, line, diagnostic.message);
+    }
+    m_diagnostics.clear();
+
+    if (m_text != nullptr)
+    {
+        *m_text += out;
+    }
+    else
+    {
+        *m_stream << out << std::flush;
+    }
 }
 
 void error::unreachable()
 {
     auto trace = boost::stacktrace::stacktrace(0, 10);
-    std::cout << trace << '\n';
-    throw Fatal("unreachable code was reached");
+    // reported like any other diagnostic, as stdout may carry the output
+    report(no_offset, "Stack trace:\n" + boost::stacktrace::to_string(trace));
+    fatal("unreachable code was reached");
 }
 
 void error::todo(std::string message)
 {
-    std::cout << "TODO: " << message << '\n';
+    report(no_offset, "Not implemented: " + std::move(message));
 }
 
-void error::fatal(std::string message) { throw Fatal(message); }
-
-void error::synchronize(int line, std::string message)
+void error::fatal(std::string message)
 {
-    throw Synchronize(line, message);
+    report(no_offset, std::move(message));
+    throw Fatal();
 }
 
-void error::report(int line, std::string message)
+void error::report(uint32_t offset, std::string message)
 {
-    if (line == -1)
+    if (silent)
     {
-        std::cout << MAGENTA << "[Fatal error] " << RED << message << RESET
-                  << '\n';
+        return;
     }
-    else
+    if (captured != nullptr)
+    {
+        captured->push_back({offset, std::move(message)});
+        return;
+    }
+    // every entry point installs one of these; a library user who does not
+    // loses the diagnostic, while fatal() still throws
+    if (engine != nullptr)
     {
-        std::cout << MAGENTA << "[line " << line << "] " << RED << message
-                  << RESET << '\n';
+        engine->add(offset, std::move(message));
     }
 }
+
+bool error::limit_reached()
+{
+    return captured == nullptr && engine != nullptr && engine->full();
+}
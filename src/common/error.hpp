@@ -1,27 +1,104 @@
 #ifndef ERROR_HPP
 #define ERROR_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
 #include <string>
+#include <string_view>
+#include <vector>
 
+#include "source.hpp"
+
+// Diagnostics are located by the byte offset of the offending token. The
+// offset is decoded into a line through the source given to the
+// DiagnosticEngine, and only once the diagnostic is actually printed.
 namespace error
 {
+// Location of diagnostics that do not belong to any token.
+inline constexpr uint32_t no_offset = UINT32_MAX;
+
+// Thrown by fatal() to abandon compilation, once the reason is reported.
 struct Fatal
 {
-    Fatal(std::string message);
-    ~Fatal() = default;
 };
 
-struct Synchronize
+// Drops everything reported on the current thread while it is alive. Used
+// for speculative work that is redone with reporting enabled if it fails.
+class Silence
+{
+   public:
+    Silence();
+    ~Silence();
+
+   private:
+    bool m_was_silent;
+};
+
+struct Diagnostic
+{
+    uint32_t offset;
+    std::string message;
+};
+
+// Collects everything reported on the current thread into `into` instead
+// of printing it, while it is alive.
+class Capture
+{
+   public:
+    Capture(std::vector<Diagnostic> &into);
+    ~Capture();
+
+   private:
+    std::vector<Diagnostic> *m_previous;
+};
+
+// Buffers everything reported on the current thread while it is alive, and
+// prints it all at once, to a stream or appended to a string, on flush()
+// or when it goes away. Only the first
+// `limit` located diagnostics are kept, after which limit_reached() tells
+// the lexer and parser to stop looking for more. A limit of 0 keeps them
+// all. Fatal errors are always kept.
+class DiagnosticEngine
 {
-    Synchronize(int line, std::string message);
-    ~Synchronize() = default;
+   public:
+    static constexpr size_t default_limit = 100;
+
+    DiagnosticEngine(std::ostream &out, size_t limit = default_limit);
+    DiagnosticEngine(std::string &out, size_t limit = default_limit);
+    DiagnosticEngine(DiagnosticEngine const &other) = delete;
+    DiagnosticEngine &operator=(DiagnosticEngine const &other) = delete;
+    ~DiagnosticEngine();
+
+    void set_limit(size_t limit) { m_limit = limit; }
+    // The text the offsets of diagnostics point into. It has to outlive
+    // the engine, or at least the next flush().
+    void set_source(std::string_view source);
+    bool full() const { return m_limit != 0 && m_located >= m_limit; }
+    void add(uint32_t offset, std::string message);
+    void flush();
+
+   private:
+    std::ostream *m_stream;
+    std::string *m_text;
+    std::string_view m_source;
+    common::LineIndex m_lines;
+    size_t m_limit;
+    // located diagnostics reported so far, including those not kept
+    size_t m_located;
+    std::vector<Diagnostic> m_diagnostics;
+    DiagnosticEngine *m_previous;
 };
 
+// Reports a stack trace, then fails.
 void unreachable();
 void todo(std::string message);
-void fatal(std::string message);
-void synchronize(int line, std::string message);
-void report(int line, std::string message);
+[[noreturn]] void fatal(std::string message);
+// Hands a diagnostic to the Capture or else the DiagnosticEngine of the
+// current thread, unless it is silenced. With neither alive it is dropped.
+void report(uint32_t offset, std::string message);
+// Whether the diagnostic engine of the current thread is full.
+bool limit_reached();
 }  // namespace error
 
 #endif
@@ -1,22 +1,33 @@
 #ifndef EXPRESSION_HPP
 #define EXPRESSION_HPP
 
-#include <cstddef>
-#include <memory>
-#include <vector>
+#include <cstdint>
 
 #include "token.hpp"
 
-struct LocalVar
+// Index of a token in Ast::tokens.
+using TokenRef = uint32_t;
+
+// Where the analyzer found the declaration a name refers to: the frame of
+// the function nesting level that declares it (0 for the top level) and
+// the variable's slot in that frame. Parameters take the first slots of
+// their function's frame, slots are reused once a block's variables go
+// out of scope.
+struct Binding
 {
-    LocalVar(Token token, int scope_depth);
-    ~LocalVar() = default;
+    uint32_t depth = UINT32_MAX;
+    uint32_t slot = UINT32_MAX;
 
-    Token token;
-    int scope_depth;
+    bool is_none() const { return slot == UINT32_MAX; }
 };
 
-enum class ExprType
+struct LocalVar
+{
+    TokenRef token;
+    Binding binding;
+};
+
+enum class ExprType : uint8_t
 {
     Binary,
     Literal,
@@ -27,105 +38,85 @@ enum class ExprType
     Call,
 };
 
-struct Expr;
+// Refers to an expression node in an Ast. The kind is kept in the top bits
+// and selects the array the node lives in, the remaining bits are the
+// node's index into that array.
+struct ExprRef
+{
+    static constexpr uint32_t index_bits = 29;
+    static constexpr uint32_t index_mask = (1u << index_bits) - 1;
+
+    uint32_t bits = UINT32_MAX;
+
+    ExprRef() = default;
+    ExprRef(ExprType kind, uint32_t index)
+        : bits(static_cast<uint32_t>(kind) << index_bits | index)
+    {
+    }
+
+    ExprType kind() const { return static_cast<ExprType>(bits >> index_bits); }
+    uint32_t index() const { return bits & index_mask; }
+    bool is_none() const { return bits == UINT32_MAX; }
+};
 
 struct BinaryExpr
 {
-    BinaryExpr(
-        std::unique_ptr<Expr> left, Token &&op, std::unique_ptr<Expr> right
-    );
-    BinaryExpr(BinaryExpr &&expr) = default;
-    ~BinaryExpr() = default;
-
-    std::unique_ptr<Expr> left;
-    Token op;
-    std::unique_ptr<Expr> right;
+    static constexpr ExprType kind = ExprType::Binary;
+
+    ExprRef left;
+    ExprRef right;
+    TokenType op;
 };
 
 struct LiteralExpr
 {
-    LiteralExpr(Token &&token);
-    LiteralExpr(LiteralExpr &&expr) = default;
-    ~LiteralExpr() = default;
+    static constexpr ExprType kind = ExprType::Literal;
 
-    Token token;
+    int64_t value;
 };
 
 struct VarExpr
 {
-    VarExpr(LocalVar &&var);
-    VarExpr(VarExpr &&expr) = default;
-    ~VarExpr() = default;
+    static constexpr ExprType kind = ExprType::Var;
 
-    LocalVar var;
+    TokenRef name;
+    // filled in by the analyzer, none for callees
+    Binding binding;
 };
 
 struct AssignExpr
 {
-    AssignExpr(LocalVar &&var, std::unique_ptr<Expr> expr);
-    AssignExpr(AssignExpr &&expr) = default;
-    ~AssignExpr() = default;
+    static constexpr ExprType kind = ExprType::Assign;
 
-    LocalVar var;
-    std::unique_ptr<Expr> expr;
+    TokenRef name;
+    ExprRef expr;
+    // filled in by the analyzer
+    Binding binding;
 };
 
 struct UnaryExpr
 {
-    UnaryExpr(Token &&op, std::unique_ptr<Expr> expr);
-    UnaryExpr(UnaryExpr &&expr) = default;
-    ~UnaryExpr() = default;
+    static constexpr ExprType kind = ExprType::Unary;
 
-    Token op;
-    std::unique_ptr<Expr> expr;
+    ExprRef expr;
+    TokenType op;
 };
 
 struct GroupingExpr
 {
-    GroupingExpr(std::unique_ptr<Expr> expr);
-    GroupingExpr(GroupingExpr &&expr) = default;
-    ~GroupingExpr() = default;
+    static constexpr ExprType kind = ExprType::Grouping;
 
-    std::unique_ptr<Expr> expr;
+    ExprRef expr;
 };
 
+// The arguments are `arg_count` consecutive entries of Ast::expr_lists.
 struct CallExpr
 {
-    CallExpr(std::unique_ptr<Expr> callee, std::vector<std::unique_ptr<Expr>> args);
-    CallExpr(CallExpr &&expr) = default;
-    ~CallExpr() = default;
+    static constexpr ExprType kind = ExprType::Call;
 
-    std::unique_ptr<Expr> callee;
-    std::vector<std::unique_ptr<Expr>> args;
-};
-
-struct Expr
-{
-    Expr(size_t line, BinaryExpr &&expr);
-    Expr(size_t line, LiteralExpr &&expr);
-    Expr(size_t line, VarExpr &&expr);
-    Expr(size_t line, AssignExpr &&expr);
-    Expr(size_t line, UnaryExpr &&expr);
-    Expr(size_t line, GroupingExpr &&expr);
-    Expr(size_t line, CallExpr &&expr);
-    ~Expr();
-
-    size_t line;
-
-    ExprType kind;
-    union Variant
-    {
-        BinaryExpr binary;
-        LiteralExpr literal;
-        VarExpr var;
-        AssignExpr assign;
-        UnaryExpr unary;
-        GroupingExpr grouping;
-        CallExpr call;
-
-        Variant() {}
-        ~Variant() {}
-    } variant;
+    ExprRef callee;
+    uint32_t first_arg;
+    uint32_t arg_count;
 };
 
 #endif
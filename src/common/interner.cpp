@@ -0,0 +1,72 @@
+#include "interner.hpp"
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace common
+{
+Interner::Interner() : Interner(false) {}
+
+Interner::Interner(bool copy_all)
+    : m_slots(1024, no_symbol), m_copy_all(copy_all)
+{
+}
+
+Symbol Interner::intern(std::string_view text)
+{
+    return find_or_add(text, m_copy_all);
+}
+
+Symbol Interner::intern_copy(std::string_view text)
+{
+    return find_or_add(text, true);
+}
+
+Symbol Interner::find_or_add(std::string_view text, bool copy)
+{
+    size_t hash = std::hash<std::string_view>()(text);
+    size_t mask = m_slots.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
+    {
+        Symbol symbol = m_slots[slot];
+        if (symbol == no_symbol)
+        {
+            if (copy)
+            {
+                text = m_owned.emplace_back(text);
+            }
+            symbol = m_names.size();
+            m_names.push_back(text);
+            m_hashes.push_back(hash);
+            m_slots[slot] = symbol;
+
+            // keep the table at most half full
+            if (m_names.size() * 2 > m_slots.size())
+            {
+                grow();
+            }
+            return symbol;
+        }
+        if (m_hashes[symbol] == hash && m_names[symbol] == text)
+        {
+            return symbol;
+        }
+    }
+}
+
+void Interner::grow()
+{
+    m_slots.assign(m_slots.size() * 2, no_symbol);
+    size_t mask = m_slots.size() - 1;
+    for (Symbol symbol = 0; symbol < m_names.size(); ++symbol)
+    {
+        size_t slot = m_hashes[symbol] & mask;
+        while (m_slots[slot] != no_symbol)
+        {
+            slot = (slot + 1) & mask;
+        }
+        m_slots[slot] = symbol;
+    }
+}
+}  // namespace common
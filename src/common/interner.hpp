@@ -0,0 +1,57 @@
+#ifndef COMMON_INTERNER_HPP
+#define COMMON_INTERNER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace common
+{
+// Dense ID of an interned string, numbered from 0 in order of first use.
+using Symbol = uint32_t;
+
+inline constexpr Symbol no_symbol = UINT32_MAX;
+
+// Maps every distinct name to a Symbol once, so later phases compare names
+// as integers and key their tables by ID. The lexer interns identifiers
+// as views into the source buffer; names made up later (temporaries,
+// labels) are copied into storage owned by the interner.
+class Interner
+{
+   public:
+    Interner();
+    // With `copy_all`, intern() copies like intern_copy(), for sources
+    // that change or go away while the interner lives.
+    explicit Interner(bool copy_all);
+    Interner(Interner const &other) = delete;
+    Interner &operator=(Interner const &other) = delete;
+
+    // `text` has to outlive the interner, e.g. a view into the source.
+    Symbol intern(std::string_view text);
+    // Copies `text` if it has not been seen yet.
+    Symbol intern_copy(std::string_view text);
+
+    // The empty string for no_symbol.
+    std::string_view name(Symbol symbol) const
+    {
+        return symbol == no_symbol ? std::string_view() : m_names[symbol];
+    }
+    size_t size() const { return m_names.size(); }
+
+   private:
+    Symbol find_or_add(std::string_view text, bool copy);
+    void grow();
+
+    std::vector<std::string_view> m_names;
+    std::vector<size_t> m_hashes;
+    // open addressing over symbols, no_symbol marks an empty slot
+    std::vector<Symbol> m_slots;
+    std::deque<std::string> m_owned;
+    bool m_copy_all;
+};
+}  // namespace common
+
+#endif
@@ -2,178 +2,344 @@
 
 #include "error.hpp"
 
+#include <charconv>
+#include <limits>
 #include <string>
+#include <vector>
 
-AssignIR::AssignIR(std::string dst, std::string src) : dst(dst), src(src) {}
+Operand Operand::immediate(int64_t value, common::Interner &names)
+{
+    if (value >= std::numeric_limits<int32_t>::min() &&
+        value <= std::numeric_limits<int32_t>::max())
+    {
+        return {OperandKind::Imm, static_cast<uint32_t>(value)};
+    }
+    return {OperandKind::WideImm, names.intern_copy(std::to_string(value))};
+}
 
-BinaryOpIR::BinaryOpIR(
-    std::string dst, std::string left, std::string op, std::string right
-)
+int64_t Operand::value(common::Interner const &names) const
+{
+    if (kind == OperandKind::Imm)
+    {
+        return static_cast<int32_t>(id);
+    }
+    std::string_view digits = names.name(id);
+    int64_t value = 0;
+    std::from_chars(digits.data(), digits.data() + digits.size(), value);
+    return value;
+}
+
+void Operand::print(common::Writer &out, common::Interner const &names) const
+{
+    switch (kind)
+    {
+    case OperandKind::None:
+        return;
+    case OperandKind::Temp:
+        out << 't' << id;
+        return;
+    case OperandKind::Var:
+    case OperandKind::WideImm:
+        out << names.name(id);
+        return;
+    case OperandKind::Imm:
+        out << static_cast<int32_t>(id);
+        return;
+    case OperandKind::Label:
+        out << 'L' << id;
+        return;
+    case OperandKind::Func:
+        out << "func_" << names.name(id);
+        return;
+    }
+
+    error::unreachable();
+}
+
+std::string_view IROp_to_lexeme(IROp op)
+{
+    switch (op)
+    {
+    case IROp::Add:
+        return "+";
+    case IROp::Sub:
+    case IROp::Neg:
+        return "-";
+    case IROp::Mul:
+        return "*";
+    case IROp::Div:
+        return "/";
+    case IROp::Equal:
+        return "==";
+    case IROp::NotEqual:
+        return "!=";
+    case IROp::Less:
+        return "<";
+    case IROp::LessEqual:
+        return "<=";
+    case IROp::Greater:
+        return ">";
+    case IROp::GreaterEqual:
+        return ">=";
+    case IROp::And:
+        return "&&";
+    case IROp::Or:
+        return "||";
+    case IROp::Not:
+        return "!";
+    }
+
+    error::unreachable();
+    return "";
+}
+
+AssignIR::AssignIR(Operand dst, Operand src) : dst(dst), src(src) {}
+
+BinaryOpIR::BinaryOpIR(Operand dst, Operand left, IROp op, Operand right)
     : dst(dst), left(left), op(op), right(right)
 {
 }
 
-UnaryOpIR::UnaryOpIR(std::string dst, std::string op, std::string value)
+UnaryOpIR::UnaryOpIR(Operand dst, IROp op, Operand value)
     : dst(dst), op(op), value(value)
 {
 }
 
-GotoIR::GotoIR(std::string label) : label(label) {}
+GotoIR::GotoIR(Operand label) : label(label) {}
 
-IfFalseGotoIR::IfFalseGotoIR(std::string condition, std::string label)
+IfFalseGotoIR::IfFalseGotoIR(Operand condition, Operand label)
     : condition(condition), label(label)
 {
 }
 
-LabelIR::LabelIR(std::string name) : name(name) {}
+LabelIR::LabelIR(Operand name) : name(name) {}
 
-PrintIR::PrintIR(std::string value) : value(value) {}
+PrintIR::PrintIR(Operand value) : value(value) {}
 
 CallIR::CallIR(
-    std::string dst, std::string funcName, std::vector<std::string> args
+    Operand dst, Operand func, uint32_t first_arg, uint32_t arg_count
 )
-    : dst(dst), funcName(funcName), args(args)
+    : dst(dst), func(func), first_arg(first_arg), arg_count(arg_count)
 {
 }
 
-ReturnIR::ReturnIR(std::string value) : value(value) {}
+ReturnIR::ReturnIR(Operand value) : value(value) {}
 
-IRInstr::IRInstr(AssignIR &&instr) : kind(IRType::Assign)
+PhiIR::PhiIR(Operand dst, uint32_t first_arg, uint32_t arg_count)
+    : dst(dst), first_arg(first_arg), arg_count(arg_count)
 {
-    new (&variant.assign) AssignIR(std::move(instr));
 }
 
-IRInstr::IRInstr(BinaryOpIR &&instr) : kind(IRType::BinaryOp)
+IRInstr::IRInstr(AssignIR instr) : kind(IRType::Assign)
 {
-    new (&variant.binaryOp) BinaryOpIR(std::move(instr));
+    variant.assign = instr;
 }
 
-IRInstr::IRInstr(UnaryOpIR &&instr) : kind(IRType::UnaryOp)
+IRInstr::IRInstr(BinaryOpIR instr) : kind(IRType::BinaryOp)
 {
-    new (&variant.unaryOp) UnaryOpIR(std::move(instr));
+    variant.binaryOp = instr;
 }
 
-IRInstr::IRInstr(GotoIR &&instr) : kind(IRType::Goto)
+IRInstr::IRInstr(UnaryOpIR instr) : kind(IRType::UnaryOp)
 {
-    new (&variant.goto_) GotoIR(std::move(instr));
+    variant.unaryOp = instr;
 }
 
-IRInstr::IRInstr(IfFalseGotoIR &&instr) : kind(IRType::IfFalseGoto)
-{
-    new (&variant.ifFalseGoto) IfFalseGotoIR(std::move(instr));
-}
+IRInstr::IRInstr(GotoIR instr) : kind(IRType::Goto) { variant.goto_ = instr; }
 
-IRInstr::IRInstr(LabelIR &&instr) : kind(IRType::Label)
+IRInstr::IRInstr(IfFalseGotoIR instr) : kind(IRType::IfFalseGoto)
 {
-    new (&variant.label) LabelIR(std::move(instr));
+    variant.ifFalseGoto = instr;
 }
 
-IRInstr::IRInstr(PrintIR &&instr) : kind(IRType::Print)
+IRInstr::IRInstr(LabelIR instr) : kind(IRType::Label)
 {
-    new (&variant.print) PrintIR(std::move(instr));
+    variant.label = instr;
 }
 
-IRInstr::IRInstr(CallIR &&instr) : kind(IRType::Call)
+IRInstr::IRInstr(PrintIR instr) : kind(IRType::Print)
 {
-    new (&variant.call) CallIR(std::move(instr));
+    variant.print = instr;
 }
 
-IRInstr::IRInstr(ReturnIR &&instr) : kind(IRType::Return)
+IRInstr::IRInstr(CallIR instr) : kind(IRType::Call) { variant.call = instr; }
+
+IRInstr::IRInstr(ReturnIR instr) : kind(IRType::Return)
 {
-    new (&variant.return_) ReturnIR(std::move(instr));
+    variant.return_ = instr;
 }
 
-IRInstr::~IRInstr()
+IRInstr::IRInstr(PhiIR instr) : kind(IRType::Phi) { variant.phi = instr; }
+
+IRInstr::IRInstr() : kind(IRType::Nop) {}
+
+Operand *IRInstr::dst()
 {
     switch (kind)
     {
     case IRType::Assign:
-        variant.assign.~AssignIR();
-        break;
+        return &variant.assign.dst;
     case IRType::BinaryOp:
-        variant.binaryOp.~BinaryOpIR();
-        break;
+        return &variant.binaryOp.dst;
     case IRType::UnaryOp:
-        variant.unaryOp.~UnaryOpIR();
-        break;
+        return &variant.unaryOp.dst;
+    case IRType::Call:
+        return variant.call.dst.is_none() ? nullptr : &variant.call.dst;
+    case IRType::Phi:
+        return &variant.phi.dst;
     case IRType::Goto:
-        variant.goto_.~GotoIR();
-        break;
     case IRType::IfFalseGoto:
-        variant.ifFalseGoto.~IfFalseGotoIR();
-        break;
     case IRType::Label:
-        variant.label.~LabelIR();
-        break;
     case IRType::Print:
-        variant.print.~PrintIR();
-        break;
-    case IRType::Call:
-        variant.call.~CallIR();
-        break;
     case IRType::Return:
-        variant.return_.~ReturnIR();
-        break;
+    case IRType::Nop:
+        return nullptr;
     }
+
+    error::unreachable();
+    return nullptr;
 }
 
-std::string IRInstr::to_string()
+void IRFunction::emit_call(
+    Operand dst, Operand func, std::span<Operand const> args
+)
 {
-    switch (kind)
+    code.push_back(
+        CallIR(dst, func, add_list(args), static_cast<uint32_t>(args.size()))
+    );
+}
+
+uint32_t IRFunction::add_list(std::span<Operand const> list)
+{
+    uint32_t first = static_cast<uint32_t>(operand_lists.size());
+    operand_lists.insert(operand_lists.end(), list.begin(), list.end());
+    return first;
+}
+
+void IRFunction::compact()
+{
+    std::erase_if(
+        code, [](IRInstr const &instr) { return instr.kind == IRType::Nop; }
+    );
+}
+
+static void print_instr(
+    common::Writer &out, common::Interner const &names,
+    IRFunction const &func, IRInstr const &instr
+)
+{
+    switch (instr.kind)
     {
     case IRType::Assign:
     {
-        auto &ir = variant.assign;
-        return ir.dst + " = " + ir.src;
+        auto &ir = instr.variant.assign;
+        ir.dst.print(out, names);
+        out << " = ";
+        ir.src.print(out, names);
+        return;
     }
     case IRType::BinaryOp:
     {
-        auto &ir = variant.binaryOp;
-        return ir.dst + " = " + ir.left + " " + ir.op + " " + ir.right;
+        auto &ir = instr.variant.binaryOp;
+        ir.dst.print(out, names);
+        out << " = ";
+        ir.left.print(out, names);
+        out << ' ' << IROp_to_lexeme(ir.op) << ' ';
+        ir.right.print(out, names);
+        return;
     }
     case IRType::UnaryOp:
     {
-        auto &ir = variant.unaryOp;
-        return ir.dst + " = " + ir.op + " " + ir.value;
+        auto &ir = instr.variant.unaryOp;
+        ir.dst.print(out, names);
+        out << " = " << IROp_to_lexeme(ir.op) << ' ';
+        ir.value.print(out, names);
+        return;
     }
     case IRType::Goto:
     {
-        auto &ir = variant.goto_;
-        return "goto " + ir.label;
+        auto &ir = instr.variant.goto_;
+        out << "goto ";
+        ir.label.print(out, names);
+        return;
     }
     case IRType::IfFalseGoto:
     {
-        auto &ir = variant.ifFalseGoto;
-        return "ifFalse " + ir.condition + " goto " + ir.label;
+        auto &ir = instr.variant.ifFalseGoto;
+        out << "ifFalse ";
+        ir.condition.print(out, names);
+        out << " goto ";
+        ir.label.print(out, names);
+        return;
     }
     case IRType::Label:
     {
-        auto &ir = variant.label;
-        return ir.name + ":";
+        auto &ir = instr.variant.label;
+        ir.name.print(out, names);
+        out << ':';
+        return;
     }
     case IRType::Print:
     {
-        auto &ir = variant.print;
-        return "print " + ir.value;
+        auto &ir = instr.variant.print;
+        out << "print ";
+        ir.value.print(out, names);
+        return;
     }
     case IRType::Call:
     {
-        auto &ir = variant.call;
-        std::string str = ir.funcName + "(";
-        for (auto const &arg : ir.args)
+        auto &ir = instr.variant.call;
+        out << names.name(ir.func.id) << '(';
+        for (Operand arg : func.args(ir))
         {
-            str += arg + " ";
+            arg.print(out, names);
+            out << ' ';
         }
-        str += ")";
-        return str;
+        out << ')';
+        return;
     }
     case IRType::Return:
     {
-        auto &ir = variant.return_;
-        return "return " + ir.value;
+        auto &ir = instr.variant.return_;
+        out << "return ";
+        ir.value.print(out, names);
+        return;
+    }
+    case IRType::Phi:
+    {
+        auto &ir = instr.variant.phi;
+        ir.dst.print(out, names);
+        out << " = phi(";
+        std::span<Operand const> args = func.args(ir);
+        for (size_t ix = 0; ix < args.size(); ++ix)
+        {
+            out << (ix == 0 ? "" : ", ");
+            args[ix].print(out, names);
+        }
+        out << ')';
+        return;
     }
+    case IRType::Nop:
+        out << "nop";
+        return;
     }
 
     error::unreachable();
-    return "";
+}
+
+void IRFunction::print(common::Writer &out, common::Interner const &names)
+    const
+{
+    for (IRInstr const &instr : code)
+    {
+        print_instr(out, names, *this, instr);
+        out << '\n';
+    }
+}
+
+void IRFunction::print(
+    common::Writer &out, common::Interner const &names, IRInstr const &instr
+) const
+{
+    print_instr(out, names, *this, instr);
 }
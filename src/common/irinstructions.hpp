@@ -1,9 +1,15 @@
 #ifndef COMMON_IR_INSTRUCTIONS_HPP
 #define COMMON_IR_INSTRUCTIONS_HPP
 
-#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
 #include <vector>
 
+#include "interner.hpp"
+#include "output.hpp"
+
 enum class IRType
 {
     Assign,
@@ -15,116 +21,196 @@ enum class IRType
     Print,
     Call,
     Return,
+    // joins the values reaching a block in SSA form, see ssa.hpp
+    Phi,
+    // left behind by IRFunction::remove()
+    Nop,
+};
+
+// What the ID of an operand stands for.
+enum class OperandKind : uint8_t
+{
+    None,
+    // temporary number ID, "tID"
+    Temp,
+    // the Symbol of a variable's storage
+    Var,
+    // an immediate, whose value is the ID
+    Imm,
+    // an immediate that does not fit 32 bits, the Symbol of its digits
+    WideImm,
+    // label number ID, "LID"
+    Label,
+    // the Symbol of a function's name, whose code starts at "func_<name>"
+    Func,
 };
 
-struct IRInstr;
+// An instruction operand as a tagged 32 bit ID, so instructions hold no
+// strings and operands compare and hash as integers.
+struct Operand
+{
+    OperandKind kind = OperandKind::None;
+    uint32_t id = 0;
+
+    static Operand temp(uint32_t number)
+    {
+        return {OperandKind::Temp, number};
+    }
+    static Operand var(common::Symbol name)
+    {
+        return {OperandKind::Var, name};
+    }
+    static Operand label(uint32_t number)
+    {
+        return {OperandKind::Label, number};
+    }
+    static Operand func(common::Symbol name)
+    {
+        return {OperandKind::Func, name};
+    }
+    // Interns the digits of values that do not fit the ID.
+    static Operand immediate(int64_t value, common::Interner &names);
+    // The value of an immediate.
+    int64_t value(common::Interner const &names) const;
+
+    bool is_none() const { return kind == OperandKind::None; }
+    // temporaries and variables, which have storage
+    bool is_storage() const
+    {
+        return kind == OperandKind::Temp || kind == OperandKind::Var;
+    }
+    bool is_immediate() const
+    {
+        return kind == OperandKind::Imm || kind == OperandKind::WideImm;
+    }
+    bool operator==(Operand const &other) const = default;
+
+    // Writes the operand the way the dump and the assembly spell it.
+    void print(common::Writer &out, common::Interner const &names) const;
+};
+
+enum class IROp : uint8_t
+{
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Equal,
+    NotEqual,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual,
+    And,
+    Or,
+    // unary
+    Neg,
+    Not,
+};
+
+// The source spelling of an operator, e.g. "<=" for LessEqual.
+std::string_view IROp_to_lexeme(IROp op);
 
 struct AssignIR
 {
-    AssignIR(std::string dst, std::string src);
-    AssignIR(AssignIR &&instr) = default;
-    ~AssignIR() = default;
+    AssignIR(Operand dst, Operand src);
 
-    std::string dst;
-    std::string src;
+    Operand dst;
+    Operand src;
 };
 
 struct BinaryOpIR
 {
-    BinaryOpIR(
-        std::string dst, std::string left, std::string op, std::string right
-    );
-    BinaryOpIR(BinaryOpIR &&instr) = default;
-    ~BinaryOpIR() = default;
+    BinaryOpIR(Operand dst, Operand left, IROp op, Operand right);
 
-    std::string dst;
-    std::string left;
-    std::string op;
-    std::string right;
+    Operand dst;
+    Operand left;
+    IROp op;
+    Operand right;
 };
 
 struct UnaryOpIR
 {
-    UnaryOpIR(std::string dst, std::string op, std::string val);
-    UnaryOpIR(UnaryOpIR &&instr) = default;
-    ~UnaryOpIR() = default;
+    UnaryOpIR(Operand dst, IROp op, Operand val);
 
-    std::string dst;
-    std::string op;
-    std::string value;
+    Operand dst;
+    IROp op;
+    Operand value;
 };
 
 struct GotoIR
 {
-    GotoIR(std::string label);
-    GotoIR(GotoIR &&instr) = default;
-    ~GotoIR() = default;
+    GotoIR(Operand label);
 
-    std::string label;
+    Operand label;
 };
 
 struct IfFalseGotoIR
 {
-    IfFalseGotoIR(std::string condition, std::string label);
-    IfFalseGotoIR(IfFalseGotoIR &&instr) = default;
-    ~IfFalseGotoIR() = default;
+    IfFalseGotoIR(Operand condition, Operand label);
 
-    std::string condition;
-    std::string label;
+    Operand condition;
+    Operand label;
 };
 
 struct LabelIR
 {
-    LabelIR(std::string label);
-    LabelIR(LabelIR &&instr) = default;
-    ~LabelIR() = default;
+    LabelIR(Operand label);
 
-    std::string name;
+    Operand name;
 };
 
 struct PrintIR
 {
-    PrintIR(std::string label);
-    PrintIR(PrintIR &&instr) = default;
-    ~PrintIR() = default;
+    PrintIR(Operand label);
 
-    std::string value;
+    Operand value;
 };
 
+// The arguments are kept by the function, see IRFunction::args().
 struct CallIR
 {
-    CallIR(
-        std::string dst, std::string funcName, std::vector<std::string> args
-    );
-    CallIR(CallIR &&instr) = default;
-    ~CallIR() = default;
+    CallIR(Operand dst, Operand func, uint32_t first_arg, uint32_t arg_count);
 
-    std::string dst;
-    std::string funcName;
-    std::vector<std::string> args;
+    Operand dst;
+    Operand func;
+    uint32_t first_arg;
+    uint32_t arg_count;
 };
 
 struct ReturnIR
 {
-    ReturnIR(std::string value);
-    ReturnIR(ReturnIR &&instr) = default;
-    ~ReturnIR() = default;
+    ReturnIR(Operand value);
 
-    std::string value;
+    Operand value;
 };
 
+// Takes the value of argument `ix` when entered from predecessor `ix` of
+// its block. The arguments are kept by the function like those of calls.
+struct PhiIR
+{
+    PhiIR(Operand dst, uint32_t first_arg, uint32_t arg_count);
+
+    Operand dst;
+    uint32_t first_arg;
+    uint32_t arg_count;
+};
+
+// An instruction as a plain value, stored in the arrays of its function.
 struct IRInstr
 {
-    IRInstr(AssignIR &&instr);
-    IRInstr(BinaryOpIR &&instr);
-    IRInstr(UnaryOpIR &&instr);
-    IRInstr(GotoIR &&instr);
-    IRInstr(IfFalseGotoIR &&instr);
-    IRInstr(LabelIR &&instr);
-    IRInstr(PrintIR &&instr);
-    IRInstr(CallIR &&instr);
-    IRInstr(ReturnIR &&instr);
-    ~IRInstr();
+    IRInstr(AssignIR instr);
+    IRInstr(BinaryOpIR instr);
+    IRInstr(UnaryOpIR instr);
+    IRInstr(GotoIR instr);
+    IRInstr(IfFalseGotoIR instr);
+    IRInstr(LabelIR instr);
+    IRInstr(PrintIR instr);
+    IRInstr(CallIR instr);
+    IRInstr(ReturnIR instr);
+    IRInstr(PhiIR instr);
+    // Nop
+    IRInstr();
 
     IRType kind;
     union Variant
@@ -138,12 +224,114 @@ struct IRInstr
         PrintIR print;
         CallIR call;
         ReturnIR return_;
+        PhiIR phi;
 
         Variant() {}
-        ~Variant() {}
     } variant;
 
-    std::string to_string();
+    // The operand the instruction writes, or nullptr. Calls write theirs
+    // only when they have one.
+    Operand *dst();
+    Operand const *dst() const
+    {
+        return const_cast<IRInstr *>(this)->dst();
+    }
+};
+
+// The code of a function, or the top-level code of a program. It owns its
+// instructions, stored by value in one array, and the arguments of its
+// calls and phis in another, so passes over it scan memory linearly.
+struct IRFunction
+{
+    common::Symbol name = common::no_symbol;
+    std::vector<Operand> params;
+    // the variables declared in the body, which nested functions may use
+    std::vector<Operand> locals;
+    std::vector<IRInstr> code;
+    std::vector<Operand> operand_lists;
+
+    void emit(IRInstr instr) { code.push_back(instr); }
+    void emit_call(Operand dst, Operand func, std::span<Operand const> args);
+    // Stores a list of operands, returning the index of its first one.
+    uint32_t add_list(std::span<Operand const> list);
+
+    // the arguments of a call or a phi
+    template <typename Instr>
+    std::span<Operand const> args(Instr const &instr) const
+    {
+        return {operand_lists.data() + instr.first_arg, instr.arg_count};
+    }
+    template <typename Instr>
+    std::span<Operand> args(Instr const &instr)
+    {
+        return {operand_lists.data() + instr.first_arg, instr.arg_count};
+    }
+
+    // Calls `use` with a reference to every operand `instr` reads.
+    template <typename Use>
+    void for_each_use(IRInstr &instr, Use use);
+
+    // Turns the instruction into a Nop, which keeps the indices of the
+    // others valid until compact() drops all of them in one pass.
+    void remove(size_t ix) { code[ix] = IRInstr(); }
+    void compact();
+
+    // One line per instruction.
+    void print(common::Writer &out, common::Interner const &names) const;
+    // One instruction of this function, without the line break.
+    void print(
+        common::Writer &out, common::Interner const &names,
+        IRInstr const &instr
+    ) const;
+};
+
+template <typename Use>
+void IRFunction::for_each_use(IRInstr &instr, Use use)
+{
+    switch (instr.kind)
+    {
+    case IRType::Assign:
+        use(instr.variant.assign.src);
+        break;
+    case IRType::BinaryOp:
+        use(instr.variant.binaryOp.left);
+        use(instr.variant.binaryOp.right);
+        break;
+    case IRType::UnaryOp:
+        use(instr.variant.unaryOp.value);
+        break;
+    case IRType::IfFalseGoto:
+        use(instr.variant.ifFalseGoto.condition);
+        break;
+    case IRType::Print:
+        use(instr.variant.print.value);
+        break;
+    case IRType::Call:
+        for (Operand &arg : args(instr.variant.call))
+        {
+            use(arg);
+        }
+        break;
+    case IRType::Phi:
+        for (Operand &arg : args(instr.variant.phi))
+        {
+            use(arg);
+        }
+        break;
+    case IRType::Goto:
+    case IRType::Label:
+    case IRType::Return:
+    case IRType::Nop:
+        break;
+    }
+}
+
+// The top-level code and the functions of a program, or in pipelined mode
+// of one top-level declaration. Functions are in order of definition.
+struct IRProgram
+{
+    IRFunction main;
+    std::vector<IRFunction> functions;
 };
 
 #endif
@@ -0,0 +1,59 @@
+#include "output.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace common
+{
+void Writer::fill(size_t count, char c)
+{
+    while (count > 0)
+    {
+        if (m_size == m_buffer.size())
+        {
+            flush();
+        }
+        size_t chunk = std::min(count, m_buffer.size() - m_size);
+        std::memset(m_buffer.data() + m_size, c, chunk);
+        m_size += chunk;
+        count -= chunk;
+    }
+}
+
+void Writer::flush()
+{
+    if (m_text != nullptr)
+    {
+        m_text->append(m_buffer.data(), m_size);
+    }
+    else
+    {
+        std::fwrite(m_buffer.data(), 1, m_size, m_file);
+        std::fflush(m_file);
+    }
+    m_size = 0;
+}
+
+void Writer::write_through(std::string_view text)
+{
+    flush();
+    if (text.size() >= m_buffer.size())
+    {
+        if (m_text != nullptr)
+        {
+            m_text->append(text);
+        }
+        else
+        {
+            std::fwrite(text.data(), 1, text.size(), m_file);
+        }
+        return;
+    }
+    std::memcpy(m_buffer.data(), text.data(), text.size());
+    m_size = text.size();
+}
+}  // namespace common
@@ -0,0 +1,76 @@
+#ifndef COMMON_OUTPUT_HPP
+#define COMMON_OUTPUT_HPP
+
+#include <array>
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+namespace common
+{
+// Buffered output to a stdio stream, or appended to a string, for the
+// dumps. Text is copied into a fixed buffer that is written out whenever
+// it fills up, so nothing is concatenated into intermediate strings and
+// the stream is called once per 64 KiB. Whatever is left is written out
+// on flush() or destruction.
+class Writer
+{
+   public:
+    Writer(std::FILE *file) : m_file(file), m_text(nullptr), m_size(0) {}
+    Writer(std::string &text) : m_file(nullptr), m_text(&text), m_size(0) {}
+    Writer(Writer const &other) = delete;
+    Writer &operator=(Writer const &other) = delete;
+    ~Writer() { flush(); }
+
+    Writer &operator<<(std::string_view text)
+    {
+        if (text.size() > m_buffer.size() - m_size)
+        {
+            write_through(text);
+        }
+        else
+        {
+            std::memcpy(m_buffer.data() + m_size, text.data(), text.size());
+            m_size += text.size();
+        }
+        return *this;
+    }
+
+    Writer &operator<<(char c)
+    {
+        if (m_size == m_buffer.size())
+        {
+            flush();
+        }
+        m_buffer[m_size++] = c;
+        return *this;
+    }
+
+    template <std::integral T>
+    Writer &operator<<(T value)
+    {
+        char digits[24];
+        auto end = std::to_chars(std::begin(digits), std::end(digits), value);
+        return *this << std::string_view(digits, end.ptr);
+    }
+
+    // Writes `count` copies of `c`.
+    void fill(size_t count, char c);
+    void flush();
+
+   private:
+    void write_through(std::string_view text);
+
+    std::FILE *m_file;
+    std::string *m_text;
+    std::array<char, 1 << 16> m_buffer;
+    size_t m_size;
+};
+}  // namespace common
+
+#endif
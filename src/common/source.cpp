@@ -0,0 +1,152 @@
+#include "source.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include "error.hpp"
+
+namespace common
+{
+SourceBuffer::SourceBuffer(std::string const &path)
+    : m_data(nullptr), m_size(0), m_mapped(false)
+{
+    int fd = path == "-" ? STDIN_FILENO : open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        error::fatal("Failed to open: " + path);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == -1)
+    {
+        if (fd != STDIN_FILENO)
+        {
+            close(fd);
+        }
+        error::fatal("Failed to determine file size: " + path);
+    }
+
+    if (S_ISREG(info.st_mode) && info.st_size > 0)
+    {
+        void *data =
+            mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            madvise(data, info.st_size, MADV_SEQUENTIAL);
+            m_data = static_cast<char const *>(data);
+            m_size = info.st_size;
+            m_mapped = true;
+        }
+    }
+
+    if (!m_mapped)
+    {
+        read_all(fd, path);
+    }
+
+    if (fd != STDIN_FILENO)
+    {
+        close(fd);
+    }
+}
+
+SourceBuffer::~SourceBuffer()
+{
+    if (m_mapped)
+    {
+        munmap(const_cast<char *>(m_data), m_size);
+    }
+}
+
+void SourceBuffer::read_all(int fd, std::string const &path)
+{
+    size_t size = 0;
+    m_storage.resize(64 * 1024);
+
+    while (true)
+    {
+        if (size == m_storage.size())
+        {
+            m_storage.resize(m_storage.size() * 2);
+        }
+
+        ssize_t count =
+            read(fd, m_storage.data() + size, m_storage.size() - size);
+        if (count == 0)
+        {
+            break;
+        }
+        if (count == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            error::fatal("Failed to read entire file: " + path);
+        }
+        size += count;
+    }
+
+    m_storage.resize(size);
+    m_data = m_storage.data();
+    m_size = m_storage.size();
+}
+
+void LineIndex::replace(
+    uint32_t offset, uint32_t removed, std::string_view inserted
+)
+{
+    if (m_starts.empty())
+    {
+        return;
+    }
+
+    // the lines whose preceding newline was removed
+    auto first = std::upper_bound(m_starts.begin(), m_starts.end(), offset);
+    auto last = std::upper_bound(first, m_starts.end(), offset + removed);
+    for (auto start = last; start != m_starts.end(); ++start)
+    {
+        *start += inserted.size() - removed;
+    }
+
+    std::vector<uint32_t> added;
+    for (size_t ix = 0; ix < inserted.size(); ++ix)
+    {
+        if (inserted[ix] == '\n')
+        {
+            added.push_back(offset + ix + 1);
+        }
+    }
+    first = m_starts.erase(first, last);
+    m_starts.insert(first, added.begin(), added.end());
+}
+
+LineColumn LineIndex::decode(std::string_view text, uint32_t offset)
+{
+    if (m_starts.empty())
+    {
+        char const *data = text.data();
+        m_starts.push_back(0);
+        for (void const *newline = std::memchr(data, '\n', text.size());
+             newline != nullptr;)
+        {
+            size_t start = static_cast<char const *>(newline) - data + 1;
+            m_starts.push_back(static_cast<uint32_t>(start));
+            newline = std::memchr(data + start, '\n', text.size() - start);
+        }
+    }
+
+    // the last line starting at or before the offset
+    auto line = std::upper_bound(m_starts.begin(), m_starts.end(), offset) - 1;
+    return {
+        static_cast<uint32_t>(line - m_starts.begin() + 1), offset - *line + 1
+    };
+}
+}  // namespace common
@@ -0,0 +1,58 @@
+#ifndef COMMON_SOURCE_HPP
+#define COMMON_SOURCE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace common
+{
+// Owns the text of an input file for the whole compilation. Regular files
+// are mapped into memory so the lexer scans the page cache in place, other
+// inputs (pipes, terminals) are read into a heap buffer instead. The path
+// "-" stands for stdin.
+class SourceBuffer
+{
+   public:
+    SourceBuffer(std::string const &path);
+    SourceBuffer(SourceBuffer const &other) = delete;
+    SourceBuffer &operator=(SourceBuffer const &other) = delete;
+    ~SourceBuffer();
+
+    std::string_view text() const { return {m_data, m_size}; }
+
+   private:
+    char const *m_data;
+    size_t m_size;
+    bool m_mapped;
+    std::string m_storage;
+
+    void read_all(int fd, std::string const &path);
+};
+
+// A location decoded for a diagnostic, both counted from 1.
+struct LineColumn
+{
+    uint32_t line;
+    uint32_t column;
+};
+
+// The offsets at which the lines of a text start, for decoding locations.
+// Built on the first decode.
+class LineIndex
+{
+   public:
+    // Binary searches the line starts of `text`.
+    LineColumn decode(std::string_view text, uint32_t offset);
+    // Keeps the index up to date when the text changes like this, without
+    // scanning all of it again.
+    void replace(uint32_t offset, uint32_t removed, std::string_view inserted);
+
+   private:
+    std::vector<uint32_t> m_starts;
+};
+}  // namespace common
+
+#endif
@@ -1,13 +1,11 @@
 #ifndef STATEMENTS_HPP
 #define STATEMENTS_HPP
 
-#include <memory>
-#include <vector>
+#include <cstdint>
 
-#include "token.hpp"
 #include "expression.hpp"
 
-enum class StmtType
+enum class StmtType : uint8_t
 {
     Expr,
     Print,
@@ -18,110 +16,82 @@ enum class StmtType
     Func,
 };
 
-struct Stmt;
+// Refers to a statement node in an Ast, encoded like ExprRef.
+struct StmtRef
+{
+    static constexpr uint32_t index_bits = 29;
+    static constexpr uint32_t index_mask = (1u << index_bits) - 1;
+
+    uint32_t bits = UINT32_MAX;
+
+    StmtRef() = default;
+    StmtRef(StmtType kind, uint32_t index)
+        : bits(static_cast<uint32_t>(kind) << index_bits | index)
+    {
+    }
+
+    StmtType kind() const { return static_cast<StmtType>(bits >> index_bits); }
+    uint32_t index() const { return bits & index_mask; }
+    bool is_none() const { return bits == UINT32_MAX; }
+};
 
 struct ExprStmt
 {
-    ExprStmt(std::unique_ptr<Expr> expr);
-    ExprStmt(ExprStmt &&stmt) = default;
-    ~ExprStmt() = default;
+    static constexpr StmtType kind = StmtType::Expr;
 
-    std::unique_ptr<Expr> expr;
+    ExprRef expr;
 };
 
 struct PrintStmt
 {
-    PrintStmt(std::unique_ptr<Expr> expr);
-    PrintStmt(PrintStmt &&expr) = default;
-    ~PrintStmt() = default;
+    static constexpr StmtType kind = StmtType::Print;
 
-    std::unique_ptr<Expr> expr;
+    ExprRef expr;
 };
 
 struct VarStmt
 {
-    VarStmt(LocalVar var, std::unique_ptr<Expr> expr);
-    VarStmt(VarStmt &&stmt) = default;
-    ~VarStmt() = default;
+    static constexpr StmtType kind = StmtType::Var;
 
     LocalVar var;
-    std::unique_ptr<Expr> expr;
+    ExprRef expr;
 };
 
+// The statements are `count` consecutive entries of Ast::stmt_lists.
 struct BlockStmt
 {
-    BlockStmt(std::vector<std::unique_ptr<Stmt>> statements);
-    BlockStmt(BlockStmt &&stmt) = default;
-    ~BlockStmt() = default;
+    static constexpr StmtType kind = StmtType::Block;
 
-    std::vector<std::unique_ptr<Stmt>> statements;
+    uint32_t first;
+    uint32_t count;
 };
 
 struct IfStmt
 {
-    IfStmt(
-        std::unique_ptr<Expr> condition, std::unique_ptr<Stmt> then_branch,
-        std::unique_ptr<Stmt> else_branch
-    );
-    IfStmt(IfStmt &&stmt) = default;
-    ~IfStmt() = default;
-
-    std::unique_ptr<Expr> condition;
-    std::unique_ptr<Stmt> then_branch;
-    std::unique_ptr<Stmt> else_branch;
+    static constexpr StmtType kind = StmtType::If;
+
+    ExprRef condition;
+    StmtRef then_branch;
+    StmtRef else_branch;
 };
 
 struct WhileStmt
 {
-    WhileStmt(std::unique_ptr<Expr> condition, std::unique_ptr<Stmt> body);
-    WhileStmt(WhileStmt &&stmt) = default;
-    ~WhileStmt() = default;
+    static constexpr StmtType kind = StmtType::While;
 
-    std::unique_ptr<Expr> condition;
-    std::unique_ptr<Stmt> body;
+    ExprRef condition;
+    StmtRef body;
 };
 
+// The parameters are `param_count` consecutive entries of Ast::token_lists.
 struct FuncStmt
 {
-    FuncStmt(
-        Token &&name, std::vector<Token> params,
-        std::unique_ptr<Stmt> body
-    );
-    FuncStmt(FuncStmt &&stmt) = default;
-    ~FuncStmt() = default;
-
-    Token name;
-    std::vector<Token> params;
-    std::unique_ptr<Stmt> body;
-};
+    static constexpr StmtType kind = StmtType::Func;
 
-struct Stmt
-{
-    Stmt(size_t line, ExprStmt &&expr);
-    Stmt(size_t line, PrintStmt &&expr);
-    Stmt(size_t line, VarStmt &&expr);
-    Stmt(size_t line, BlockStmt &&expr);
-    Stmt(size_t line, IfStmt &&expr);
-    Stmt(size_t line, WhileStmt &&expr);
-    Stmt(size_t line, FuncStmt &&expr);
-    ~Stmt();
-
-    size_t line;
-
-    StmtType kind;
-    union Variant
-    {
-        ExprStmt expr;
-        PrintStmt print;
-        VarStmt var;
-        BlockStmt block;
-        IfStmt if_;
-        WhileStmt while_;
-        FuncStmt func;
-
-        Variant() {}
-        ~Variant() {}
-    } variant;
+    TokenRef name;
+    uint32_t first_param;
+    uint32_t param_count;
+    StmtRef body;
 };
 
 #endif
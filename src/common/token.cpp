@@ -1,9 +1,9 @@
 #include "token.hpp"
 
-#include <iostream>
 #include "error.hpp"
+#include "output.hpp"
 
-constexpr std::string TT_to_string(TokenType kind)
+std::string_view TT_to_string(TokenType kind)
 {
     switch (kind)
     {
@@ -95,20 +95,60 @@ constexpr std::string TT_to_string(TokenType kind)
     }
 }
 
-Token::Token(
-    TokenType kind, std::string lexeme, Literal literal, uint32_t line,
-    uint32_t column
-)
-    : kind(kind), lexeme(lexeme), literal(literal), line(line), column(column)
+std::string_view TT_to_lexeme(TokenType kind)
 {
+    switch (kind)
+    {
+    case TokenType::Minus:
+        return "-";
+    case TokenType::Plus:
+        return "+";
+    case TokenType::Slash:
+        return "/";
+    case TokenType::Star:
+        return "*";
+    case TokenType::Equal:
+        return "=";
+    case TokenType::Bang:
+        return "!";
+    case TokenType::BangEqual:
+        return "!=";
+    case TokenType::EqualEqual:
+        return "==";
+    case TokenType::Greater:
+        return ">";
+    case TokenType::GreaterEqual:
+        return ">=";
+    case TokenType::Less:
+        return "<";
+    case TokenType::LessEqual:
+        return "<=";
+    case TokenType::BoolAnd:
+        return "&&";
+    case TokenType::BoolOr:
+        return "||";
+    case TokenType::LogicAnd:
+        return "&";
+    case TokenType::LogicOr:
+        return "|";
+    case TokenType::LogicXor:
+        return "^";
+    case TokenType::LogicNeg:
+        return "~";
+    default:
+        error::unreachable();
+        return "";
+    }
 }
 
-Token::~Token() {}
+std::string_view Token::lexeme(std::string_view source) const
+{
+    return source.substr(offset, length);
+}
 
-void Token::print() const
+void Token::print(common::Writer &out, std::string_view source) const
 {
-    std::cout << "{ kind: " << TT_to_string(kind) << ", lexeme: \"" << lexeme
-              << "\", ";
-    literal.print();
-    std::cout << ", line: " << line << ", column: " << column << " }\n";
+    out << "{ kind: " << TT_to_string(kind) << ", lexeme: \""
+        << lexeme(source) << "\", value: " << value
+        << ", offset: " << offset << " }\n";
 }
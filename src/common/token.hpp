@@ -2,11 +2,13 @@
 #define TOKENTYPE_HPP
 
 #include <cstdint>
+#include <initializer_list>
 #include <string>
+#include <string_view>
 
-#include "literal.hpp"
+#include "output.hpp"
 
-enum class TokenType
+enum class TokenType : uint8_t
 {
     LeftParen,
     RightParen,
@@ -51,24 +53,56 @@ enum class TokenType
     Eof,
 };
 
-constexpr std::string TT_to_string(TokenType kind);
+std::string_view TT_to_string(TokenType kind);
+// The source spelling of an operator token, e.g. "<=" for LessEqual.
+std::string_view TT_to_lexeme(TokenType kind);
 
+// A set of token kinds stored as a bitmask, so that sets spelled out at a
+// call site are folded into a constant and testing membership is a single
+// bit test.
+class TokenSet
+{
+   public:
+    constexpr TokenSet(std::initializer_list<TokenType> kinds) : m_bits(0)
+    {
+        for (TokenType kind : kinds)
+        {
+            m_bits |= uint64_t(1) << static_cast<uint8_t>(kind);
+        }
+    }
+
+    constexpr bool contains(TokenType kind) const
+    {
+        return (m_bits >> static_cast<uint8_t>(kind)) & 1;
+    }
+
+   private:
+    uint64_t m_bits;
+};
+
+static_assert(static_cast<uint8_t>(TokenType::Eof) < 64);
+
+// A token does not own its text: `offset` and `length` locate the lexeme in
+// the source buffer, which has to outlive every token lexed from it. The
+// offset is also the token's location, a common::LineIndex turns it into a
+// line and column when a diagnostic needs one.
+// Number literals are decoded once by the lexer and stored in `value`,
+// identifiers keep their interned common::Symbol there.
 struct Token
 {
-    Token(
-        TokenType kind, std::string lexeme, Literal literal, uint32_t line,
-        uint32_t column
-    );
+    Token(TokenType kind, uint32_t offset, uint32_t length, int64_t value)
+        : value(value), offset(offset), length(length), kind(kind)
+    {
+    }
     Token() = default;
-    ~Token();
 
+    int64_t value;
+    uint32_t offset;
+    uint32_t length;
     TokenType kind;
-    std::string lexeme;
-    Literal literal;
-    uint32_t line;
-    uint32_t column;
 
-    void print() const;
+    std::string_view lexeme(std::string_view source) const;
+    void print(common::Writer &out, std::string_view source) const;
 };
 
 #endif
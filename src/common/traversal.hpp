@@ -0,0 +1,276 @@
+#ifndef COMMON_TRAVERSAL_HPP
+#define COMMON_TRAVERSAL_HPP
+
+#include <cstdint>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "ast.hpp"
+#include "expression.hpp"
+#include "statements.hpp"
+
+// Either an expression or a statement, as kept on the walk stack.
+struct NodeRef
+{
+    uint32_t bits = UINT32_MAX;
+    bool is_stmt = false;
+
+    NodeRef() = default;
+    NodeRef(ExprRef ref) : bits(ref.bits), is_stmt(false) {}
+    NodeRef(StmtRef ref) : bits(ref.bits), is_stmt(true) {}
+
+    bool is_none() const { return bits == UINT32_MAX; }
+    ExprRef expr() const
+    {
+        ExprRef ref;
+        ref.bits = bits;
+        return ref;
+    }
+    StmtRef stmt() const
+    {
+        StmtRef ref;
+        ref.bits = bits;
+        return ref;
+    }
+};
+
+// Calls `fn(node, ref)` with the typed node `ref` refers to. This is the
+// only place that switches over the node kinds, passes get the typed node
+// through overload resolution instead.
+template <typename Fn>
+decltype(auto) dispatch(Ast const &ast, ExprRef ref, Fn &&fn)
+{
+    switch (ref.kind())
+    {
+    case ExprType::Binary:
+        return fn(ast.get<BinaryExpr>(ref), ref);
+    case ExprType::Literal:
+        return fn(ast.get<LiteralExpr>(ref), ref);
+    case ExprType::Var:
+        return fn(ast.get<VarExpr>(ref), ref);
+    case ExprType::Assign:
+        return fn(ast.get<AssignExpr>(ref), ref);
+    case ExprType::Unary:
+        return fn(ast.get<UnaryExpr>(ref), ref);
+    case ExprType::Grouping:
+        return fn(ast.get<GroupingExpr>(ref), ref);
+    case ExprType::Call:
+        break;
+    }
+    return fn(ast.get<CallExpr>(ref), ref);
+}
+
+template <typename Fn>
+decltype(auto) dispatch(Ast const &ast, StmtRef ref, Fn &&fn)
+{
+    switch (ref.kind())
+    {
+    case StmtType::Expr:
+        return fn(ast.get<ExprStmt>(ref), ref);
+    case StmtType::Print:
+        return fn(ast.get<PrintStmt>(ref), ref);
+    case StmtType::Var:
+        return fn(ast.get<VarStmt>(ref), ref);
+    case StmtType::Block:
+        return fn(ast.get<BlockStmt>(ref), ref);
+    case StmtType::If:
+        return fn(ast.get<IfStmt>(ref), ref);
+    case StmtType::While:
+        return fn(ast.get<WhileStmt>(ref), ref);
+    case StmtType::Func:
+        break;
+    }
+    return fn(ast.get<FuncStmt>(ref), ref);
+}
+
+// The children of every node kind in evaluation order. Returns none past
+// the last child; optional children (an initializer, an else branch) are
+// always last, so a missing one ends the list as well.
+namespace traversal
+{
+inline NodeRef child(Ast const &, BinaryExpr const &node, uint32_t ix)
+{
+    return ix == 0 ? node.left : ix == 1 ? node.right : NodeRef();
+}
+inline NodeRef child(Ast const &, LiteralExpr const &, uint32_t)
+{
+    return {};
+}
+inline NodeRef child(Ast const &, VarExpr const &, uint32_t) { return {}; }
+inline NodeRef child(Ast const &, AssignExpr const &node, uint32_t ix)
+{
+    return ix == 0 ? node.expr : NodeRef();
+}
+inline NodeRef child(Ast const &, UnaryExpr const &node, uint32_t ix)
+{
+    return ix == 0 ? node.expr : NodeRef();
+}
+inline NodeRef child(Ast const &, GroupingExpr const &node, uint32_t ix)
+{
+    return ix == 0 ? node.expr : NodeRef();
+}
+inline NodeRef child(Ast const &ast, CallExpr const &node, uint32_t ix)
+{
+    if (ix == 0)
+    {
+        return node.callee;
+    }
+    return ix <= node.arg_count ? ast.args(node)[ix - 1] : NodeRef();
+}
+inline NodeRef child(Ast const &, ExprStmt const &node, uint32_t ix)
+{
+    return ix == 0 ? node.expr : NodeRef();
+}
+inline NodeRef child(Ast const &, PrintStmt const &node, uint32_t ix)
+{
+    return ix == 0 ? node.expr : NodeRef();
+}
+inline NodeRef child(Ast const &, VarStmt const &node, uint32_t ix)
+{
+    return ix == 0 && !node.expr.is_none() ? node.expr : NodeRef();
+}
+inline NodeRef child(Ast const &ast, BlockStmt const &node, uint32_t ix)
+{
+    return ix < node.count ? ast.children(node)[ix] : NodeRef();
+}
+inline NodeRef child(Ast const &, IfStmt const &node, uint32_t ix)
+{
+    if (ix == 2 && !node.else_branch.is_none())
+    {
+        return node.else_branch;
+    }
+    return ix == 0 ? node.condition : ix == 1 ? node.then_branch : NodeRef();
+}
+inline NodeRef child(Ast const &, WhileStmt const &node, uint32_t ix)
+{
+    return ix == 0 ? node.condition : ix == 1 ? node.body : NodeRef();
+}
+inline NodeRef child(Ast const &, FuncStmt const &node, uint32_t ix)
+{
+    return ix == 0 ? node.body : NodeRef();
+}
+
+struct Frame
+{
+    NodeRef node;
+    uint32_t next_child;
+    bool descend;
+};
+
+// Calls the visitor's hook for the node's type, if it has one:
+//   bool enter(Node const &, Ref)   before the children; returning false
+//                                   skips them (a void hook never does)
+//   void after(Node const &, Ref, uint32_t ix)   after child `ix`
+//   void leave(Node const &, Ref)   after the last child
+template <typename Visitor>
+bool enter(Ast const &ast, NodeRef node, Visitor &visitor)
+{
+    auto hook = [&](auto const &typed, auto ref) -> bool
+    {
+        if constexpr (requires { visitor.enter(typed, ref); })
+        {
+            using Result = decltype(visitor.enter(typed, ref));
+            if constexpr (std::is_void_v<Result>)
+            {
+                visitor.enter(typed, ref);
+                return true;
+            }
+            else
+            {
+                return visitor.enter(typed, ref);
+            }
+        }
+        return true;
+    };
+    return node.is_stmt ? dispatch(ast, node.stmt(), hook)
+                        : dispatch(ast, node.expr(), hook);
+}
+
+template <typename Visitor>
+void after(Ast const &ast, NodeRef node, uint32_t ix, Visitor &visitor)
+{
+    auto hook = [&](auto const &typed, auto ref)
+    {
+        if constexpr (requires { visitor.after(typed, ref, ix); })
+        {
+            visitor.after(typed, ref, ix);
+        }
+    };
+    node.is_stmt ? dispatch(ast, node.stmt(), hook)
+                 : dispatch(ast, node.expr(), hook);
+}
+
+template <typename Visitor>
+void leave(Ast const &ast, NodeRef node, Visitor &visitor)
+{
+    auto hook = [&](auto const &typed, auto ref)
+    {
+        if constexpr (requires { visitor.leave(typed, ref); })
+        {
+            visitor.leave(typed, ref);
+        }
+    };
+    node.is_stmt ? dispatch(ast, node.stmt(), hook)
+                 : dispatch(ast, node.expr(), hook);
+}
+
+inline NodeRef child(Ast const &ast, NodeRef node, uint32_t ix)
+{
+    auto get = [&](auto const &typed, auto) { return child(ast, typed, ix); };
+    return node.is_stmt ? dispatch(ast, node.stmt(), get)
+                        : dispatch(ast, node.expr(), get);
+}
+
+template <typename Visitor>
+void run(
+    Ast const &ast, NodeRef root, Visitor &visitor, std::vector<Frame> &stack
+)
+{
+    stack.push_back({root, 0, enter(ast, root, visitor)});
+    while (!stack.empty())
+    {
+        Frame &top = stack.back();
+        NodeRef next = top.descend ? child(ast, top.node, top.next_child)
+                                   : NodeRef();
+        if (!next.is_none())
+        {
+            top.next_child++;
+            bool descend = enter(ast, next, visitor);
+            stack.push_back({next, 0, descend});
+            continue;
+        }
+
+        leave(ast, top.node, visitor);
+        stack.pop_back();
+        if (!stack.empty())
+        {
+            after(ast, stack.back().node, stack.back().next_child - 1, visitor);
+        }
+    }
+}
+}  // namespace traversal
+
+// Walks the trees below `roots` depth first, left to right, calling the
+// visitor's enter/after/leave hooks (see traversal::enter) on the way.
+// Pending nodes are kept on an explicit stack, so the depth of a tree only
+// costs heap memory, never native stack.
+template <typename Visitor>
+void walk(Ast const &ast, std::span<StmtRef const> roots, Visitor &visitor)
+{
+    std::vector<traversal::Frame> stack;
+    stack.reserve(64);
+    for (StmtRef root : roots)
+    {
+        traversal::run(ast, root, visitor, stack);
+    }
+}
+
+template <typename Visitor>
+void walk(Ast const &ast, NodeRef root, Visitor &visitor)
+{
+    std::vector<traversal::Frame> stack;
+    traversal::run(ast, root, visitor, stack);
+}
+
+#endif
@@ -0,0 +1,209 @@
+#include "dce.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "cfg.hpp"
+#include "common/irinstructions.hpp"
+#include "ssa.hpp"
+
+namespace
+{
+size_t code_size(CFG &cfg)
+{
+    size_t size = 0;
+    for (uint32_t block = 0; block < cfg.size(); ++block)
+    {
+        size += cfg.block(block).code.size();
+    }
+    return size;
+}
+
+// Whether an instruction does nothing but define a value.
+bool defines_only(IRInstr const &instr)
+{
+    Operand const *dst = instr.dst();
+    return dst != nullptr && is_ssa_value(*dst) && instr.kind != IRType::Call;
+}
+
+// Whether a block holds nothing but labels and a jump.
+bool is_empty(BasicBlock const &block)
+{
+    for (size_t ix = 0; ix < block.code.size(); ++ix)
+    {
+        IRType kind = block.code[ix].kind;
+        bool jump = kind == IRType::Goto && ix + 1 == block.code.size();
+        if (kind != IRType::Label && kind != IRType::Nop && !jump)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether the phis of `to` take different values from `a` and `b`, if
+// both lead there.
+bool joins_differ(CFG &cfg, uint32_t a, uint32_t b, uint32_t to)
+{
+    std::vector<uint32_t> const &preds = cfg.block(to).preds;
+    size_t from_a = std::find(preds.begin(), preds.end(), a) - preds.begin();
+    size_t from_b = std::find(preds.begin(), preds.end(), b) - preds.begin();
+    if (from_a == preds.size() || from_b == preds.size())
+    {
+        return false;
+    }
+    for (IRInstr const &instr : cfg.phis(to))
+    {
+        std::span<Operand const> args =
+            cfg.function().args(instr.variant.phi);
+        if (args[from_a] != args[from_b])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Marks the values read by instructions with an effect, then those read
+// to define marked values, and removes the definitions of the rest.
+size_t remove_dead_values(CFG &cfg)
+{
+    IRFunction &func = cfg.function();
+    struct Site
+    {
+        uint32_t block;
+        uint32_t ix;
+    };
+    std::unordered_map<uint32_t, Site> def;
+    for (uint32_t block : cfg.reverse_postorder())
+    {
+        std::vector<IRInstr> const &code = cfg.block(block).code;
+        for (uint32_t ix = 0; ix < code.size(); ++ix)
+        {
+            if (defines_only(code[ix]))
+            {
+                def.emplace(code[ix].dst()->id, Site{block, ix});
+            }
+        }
+    }
+
+    std::unordered_set<uint32_t> live;
+    std::vector<Site> work;
+    auto mark = [&](Operand &use)
+    {
+        if (!is_ssa_value(use) || !live.insert(use.id).second)
+        {
+            return;
+        }
+        auto it = def.find(use.id);
+        if (it != def.end())
+        {
+            work.push_back(it->second);
+        }
+    };
+    for (uint32_t block : cfg.reverse_postorder())
+    {
+        for (IRInstr &instr : cfg.block(block).code)
+        {
+            if (!defines_only(instr))
+            {
+                func.for_each_use(instr, mark);
+            }
+        }
+    }
+    while (!work.empty())
+    {
+        Site site = work.back();
+        work.pop_back();
+        func.for_each_use(cfg.block(site.block).code[site.ix], mark);
+    }
+
+    size_t removed = 0;
+    for (uint32_t block : cfg.reverse_postorder())
+    {
+        std::vector<IRInstr> &code = cfg.block(block).code;
+        for (IRInstr &instr : code)
+        {
+            if (instr.kind == IRType::Call &&
+                is_ssa_value(instr.variant.call.dst) &&
+                !live.contains(instr.variant.call.dst.id))
+            {
+                instr.variant.call.dst = Operand();
+            }
+        }
+        removed += std::erase_if(
+            code,
+            [&](IRInstr const &instr)
+            {
+                return defines_only(instr) &&
+                       !live.contains(instr.dst()->id);
+            }
+        );
+    }
+    return removed;
+}
+}  // namespace
+
+size_t remove_dead_code(CFG &cfg)
+{
+    size_t removed = simplify_control_flow(cfg);
+    // each may leave more for the other
+    for (size_t round = 1; round != 0; removed += round)
+    {
+        round = remove_dead_values(cfg);
+        round += remove_empty_blocks(cfg);
+    }
+    return removed;
+}
+
+size_t simplify_control_flow(CFG &cfg)
+{
+    size_t before = code_size(cfg);
+    cfg.remove_unreachable();
+    size_t removed = before - code_size(cfg);
+    return removed + remove_empty_blocks(cfg);
+}
+
+size_t remove_empty_blocks(CFG &cfg)
+{
+    size_t removed = 0;
+    for (uint32_t block = 0; block < cfg.size(); ++block)
+    {
+        BasicBlock const &b = cfg.block(block);
+        if (block == CFG::entry || b.removed || b.succs.size() != 1 ||
+            b.succs[0] == block || !is_empty(b))
+        {
+            continue;
+        }
+        uint32_t target = b.succs[0];
+        std::vector<uint32_t> preds = b.preds;
+        for (uint32_t pred : preds)
+        {
+            // dropping the branch would lose which value to take
+            if (joins_differ(cfg, pred, block, target))
+            {
+                continue;
+            }
+            std::vector<IRInstr> const &code = cfg.block(pred).code;
+            bool branch =
+                !code.empty() && code.back().kind == IRType::IfFalseGoto;
+            cfg.redirect(pred, block, target);
+            if (branch && (code.empty() ||
+                           code.back().kind != IRType::IfFalseGoto))
+            {
+                ++removed;
+            }
+        }
+        if (cfg.block(block).preds.empty())
+        {
+            removed += cfg.block(block).code.size();
+            cfg.remove_block(block);
+        }
+    }
+    return removed;
+}
@@ -0,0 +1,26 @@
+#ifndef DCE_HPP
+#define DCE_HPP
+
+#include <cstddef>
+
+#include "cfg.hpp"
+
+// Removes the code of `cfg` that has no effect: the instructions defining
+// values nothing with an effect reads, the blocks the entry does not reach
+// and the blocks that only pass control on, see remove_empty_blocks().
+// Calls stay, but drop results nothing reads. Needs SSA form. Returns how
+// many instructions were removed.
+size_t remove_dead_code(CFG &cfg);
+
+// Removes the blocks the entry does not reach and the empty ones, see
+// remove_empty_blocks(). Unlike remove_dead_code(), this works on code in
+// SSA form or not. Returns how many instructions were removed.
+size_t simplify_control_flow(CFG &cfg);
+
+// Leads the predecessors of every block holding nothing but labels and a
+// jump straight to where it goes, and removes the block. A branch whose
+// two ways then lead to the same block is dropped. Returns how many
+// instructions were removed.
+size_t remove_empty_blocks(CFG &cfg);
+
+#endif
@@ -0,0 +1,255 @@
+#include "document.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "analyzer.hpp"
+#include "common/error.hpp"
+#include "frontend.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+
+Document::Document(std::string text) : m_text(std::move(text)), m_names(true)
+{
+    std::string_view source = m_text;
+    for (SourcePart part : split_source(source, 1).parts)
+    {
+        m_begins.push_back(part.begin);
+        m_parts.push_back(
+            parse(source.substr(part.begin, part.end - part.begin))
+        );
+    }
+    for (size_t ix = 0; ix < m_parts.size(); ++ix)
+    {
+        analyze(
+            *m_parts[ix], ix == 0 ? std::span<common::Symbol const>()
+                                  : m_parts[ix - 1]->globals
+        );
+    }
+}
+
+Document::EditStats Document::edit(
+    size_t offset, size_t removed, std::string_view inserted
+)
+{
+    EditStats stats = {0, 0, 0};
+
+    // The parts the edit lies in. One that merely starts or ends at the
+    // edit is included as well, as its text could lex differently now that
+    // it is preceded or followed by something else. So is the part before
+    // one whose leading `fn` and the byte after it the edit touches, which
+    // may no longer start a part.
+    size_t first =
+        std::upper_bound(m_begins.begin(), m_begins.end(), offset) -
+        m_begins.begin() - 1;
+    if (first > 0 && offset - m_begins[first] < 3)
+    {
+        first--;
+    }
+    size_t last =
+        std::upper_bound(m_begins.begin(), m_begins.end(), offset + removed) -
+        m_begins.begin() - 1;
+
+    m_text.replace(offset, removed, inserted);
+    m_lines.replace(offset, removed, inserted);
+    for (size_t ix = last + 1; ix < m_begins.size(); ++ix)
+    {
+        m_begins[ix] = m_begins[ix] + inserted.size() - removed;
+    }
+
+    // Split the damaged text again. Should it no longer end at the top
+    // level, say after typing an opening brace, the parts after it are
+    // drawn in until it does, twice as many each time to keep this linear.
+    // Should it no longer start with a `fn`, it belongs to the part before,
+    // which is split again along with it.
+    std::string_view source = m_text;
+    size_t begin;
+    SourceSplit split;
+    while (true)
+    {
+        begin = m_begins[first];
+        for (size_t more = 1;; more *= 2)
+        {
+            size_t end = last + 1 < m_parts.size() ? m_begins[last + 1]
+                                                   : m_text.size();
+            split = split_source(source.substr(begin, end - begin), 1);
+            if (split.ends_at_top_level || last + 1 == m_parts.size())
+            {
+                break;
+            }
+            last = std::min(last + more, m_parts.size() - 1);
+        }
+        if (first == 0 || starts_part(source, begin))
+        {
+            break;
+        }
+        first--;
+    }
+
+    // Parts whose text has not changed, typically all functions but the
+    // edited one, keep their tree. The dropped parts of earlier edits are
+    // considered too, which brings back the functions swallowed by an
+    // opening brace once the closing one is typed. Once they add up to more
+    // than the text itself, only those of the previous edit are kept.
+    m_edits++;
+    if (m_dropped_size > m_text.size())
+    {
+        std::erase_if(
+            m_dropped, [this](auto const &entry)
+            { return entry.second->dropped_by + 1 < m_edits; }
+        );
+        m_dropped_size = 0;
+        for (auto const &[text, part] : m_dropped)
+        {
+            m_dropped_size += text.size();
+        }
+    }
+    for (size_t ix = first; ix <= last; ++ix)
+    {
+        std::string_view text = m_parts[ix]->text;
+        m_parts[ix]->dropped_by = m_edits;
+        m_dropped_size += text.size();
+        m_dropped.emplace(text, std::move(m_parts[ix]));
+    }
+
+    std::vector<std::unique_ptr<Part>> parts;
+    std::vector<size_t> begins;
+    for (SourcePart part : split.parts)
+    {
+        std::string_view text =
+            source.substr(begin + part.begin, part.end - part.begin);
+        auto node = m_dropped.extract(text);
+        if (node.empty())
+        {
+            parts.push_back(parse(text));
+            stats.reparsed++;
+        }
+        else
+        {
+            m_dropped_size -= text.size();
+            parts.push_back(std::move(node.mapped()));
+        }
+        begins.push_back(begin + part.begin);
+    }
+
+    m_parts.erase(m_parts.begin() + first, m_parts.begin() + last + 1);
+    m_parts.insert(
+        m_parts.begin() + first, std::make_move_iterator(parts.begin()),
+        std::make_move_iterator(parts.end())
+    );
+    m_begins.erase(m_begins.begin() + first, m_begins.begin() + last + 1);
+    m_begins.insert(m_begins.begin() + first, begins.begin(), begins.end());
+
+    // Analyze the new parts, then carry on for as long as the top-level
+    // variables in scope differ from what the next part was analyzed with.
+    for (size_t ix = first; ix < m_parts.size(); ++ix)
+    {
+        std::span<common::Symbol const> before;
+        if (ix > 0)
+        {
+            before = m_parts[ix - 1]->globals;
+        }
+
+        Part &part = *m_parts[ix];
+        if (part.analyzed && analyzed_against(part, before))
+        {
+            if (ix >= first + parts.size())
+            {
+                break;
+            }
+            continue;
+        }
+        analyze(part, before);
+        stats.reanalyzed++;
+    }
+
+    stats.parts = m_parts.size();
+    return stats;
+}
+
+std::vector<error::Diagnostic> Document::diagnostics() const
+{
+    std::vector<error::Diagnostic> diagnostics;
+    for (size_t ix = 0; ix < m_parts.size(); ++ix)
+    {
+        Part const &part = *m_parts[ix];
+        size_t count = diagnostics.size();
+        for (auto const *errors : {&part.parse_errors, &part.analysis_errors})
+        {
+            // the summaries of failed passes have no location
+            for (error::Diagnostic const &error : *errors)
+            {
+                if (error.offset != error::no_offset)
+                {
+                    uint32_t offset = m_begins[ix] + error.offset;
+                    diagnostics.push_back({offset, error.message});
+                }
+            }
+        }
+        std::stable_sort(
+            diagnostics.begin() + count, diagnostics.end(),
+            [](error::Diagnostic const &a, error::Diagnostic const &b)
+            { return a.offset < b.offset; }
+        );
+    }
+    return diagnostics;
+}
+
+std::unique_ptr<Document::Part> Document::parse(std::string_view text)
+{
+    auto part = std::make_unique<Part>();
+    part->text = text;
+
+    error::Capture capture(part->parse_errors);
+    try
+    {
+        Lexer lexer(part->text, m_names);
+        Parser parser(lexer.lex(), part->text);
+        part->tree = parser.parse();
+        part->parsed = true;
+    }
+    catch (error::Fatal const &)
+    {
+    }
+    return part;
+}
+
+bool Document::analyzed_against(
+    Part const &part, std::span<common::Symbol const> before
+)
+{
+    return part.globals.size() - part.declared == before.size() &&
+           std::equal(before.begin(), before.end(), part.globals.begin());
+}
+
+void Document::analyze(Part &part, std::span<common::Symbol const> before)
+{
+    part.analyzed = true;
+    part.analysis_errors.clear();
+    if (!part.parsed)
+    {
+        part.globals.assign(before.begin(), before.end());
+        part.declared = 0;
+        return;
+    }
+
+    Analyzer analyzer(part.tree, before);
+    {
+        error::Capture capture(part.analysis_errors);
+        try
+        {
+            analyzer.analyze();
+        }
+        catch (error::Fatal const &)
+        {
+        }
+    }
+    part.globals = analyzer.globals();
+    part.declared = part.globals.size() - before.size();
+}
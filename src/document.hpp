@@ -0,0 +1,91 @@
+#ifndef DOCUMENT_HPP
+#define DOCUMENT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "common/ast.hpp"
+#include "common/error.hpp"
+#include "common/interner.hpp"
+#include "common/source.hpp"
+
+// A source text that is kept lexed, parsed and analyzed across edits, for
+// editor diagnostics. The text is split in front of top-level functions,
+// like the parallel front end splits it, and every part keeps its own
+// tree. An edit re-splits, re-lexes and re-parses only the parts it
+// touches. Those are analyzed again, along with any later parts whose
+// top-level scope changed as a result. Every other part is reused as is.
+class Document
+{
+   public:
+    struct EditStats
+    {
+        size_t parts;
+        size_t reparsed;
+        size_t reanalyzed;
+    };
+
+    Document(std::string text);
+    Document(Document const &other) = delete;
+    Document &operator=(Document const &other) = delete;
+
+    // Replaces the `removed` bytes at `offset` by `inserted`. The range
+    // has to lie within the text.
+    EditStats edit(size_t offset, size_t removed, std::string_view inserted);
+
+    std::string_view text() const { return m_text; }
+    size_t part_count() const { return m_parts.size(); }
+
+    // Everything reported for the current text, in source order. Parts
+    // that fail to parse are not analyzed and declare no variables.
+    std::vector<error::Diagnostic> diagnostics() const;
+    common::LineColumn decode(uint32_t offset)
+    {
+        return m_lines.decode(m_text, offset);
+    }
+
+   private:
+    struct Part
+    {
+        // the part's own copy of its text, tokens are relative to it
+        std::string text;
+        Ast tree = Ast(std::string_view());
+        bool parsed = false;
+        bool analyzed = false;
+        std::vector<error::Diagnostic> parse_errors;
+        std::vector<error::Diagnostic> analysis_errors;
+        // the top-level variables in scope after this part, of which the
+        // last `declared` are its own
+        std::vector<common::Symbol> globals;
+        size_t declared = 0;
+        // the number of the edit that last replaced it
+        size_t dropped_by = 0;
+    };
+
+    std::unique_ptr<Part> parse(std::string_view text);
+    bool analyzed_against(
+        Part const &part, std::span<common::Symbol const> before
+    );
+    void analyze(Part &part, std::span<common::Symbol const> before);
+
+    std::string m_text;
+    common::LineIndex m_lines;
+    // parts are re-lexed from text that goes away, so names are copied
+    common::Interner m_names;
+    std::vector<std::unique_ptr<Part>> m_parts;
+    // the offset of each part in m_text
+    std::vector<size_t> m_begins;
+    // parts replaced by earlier edits, by text, in case it comes back
+    std::unordered_multimap<std::string_view, std::unique_ptr<Part>>
+        m_dropped;
+    size_t m_dropped_size = 0;
+    size_t m_edits = 0;
+};
+
+#endif
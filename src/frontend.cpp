@@ -0,0 +1,211 @@
+#include "frontend.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "common/ast.hpp"
+#include "common/error.hpp"
+#include "common/interner.hpp"
+#include "common/token.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+
+namespace
+{
+bool is_word(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '_';
+}
+
+// The bytes split() has to stop at: comment and string openers and braces,
+// and at the top level also the `f` that could start a `fn`.
+constexpr auto stops = [](bool top_level)
+{
+    std::array<bool, 256> table = {};
+    for (unsigned char c : {'/', '"', '{', '}'})
+    {
+        table[c] = true;
+    }
+    table['f'] = top_level;
+    return table;
+};
+constexpr auto nested_stops = stops(false);
+constexpr auto top_level_stops = stops(true);
+
+}  // namespace
+
+SourceSplit split_source(std::string_view source, size_t min_size)
+{
+    std::vector<SourcePart> parts = {{0, 0}};
+    char const *data = source.data();
+    size_t size = source.size();
+    int depth = 0;
+    // whether the source ends in a comment or string
+    bool open = false;
+
+    size_t ix = 0;
+    while (true)
+    {
+        auto const &table = depth == 0 ? top_level_stops : nested_stops;
+        while (ix < size && !table[static_cast<unsigned char>(data[ix])])
+        {
+            ix++;
+        }
+        if (ix >= size)
+        {
+            break;
+        }
+
+        char c = data[ix];
+        char next = ix + 1 < size ? data[ix + 1] : '\0';
+        if (c == '/' && next == '/')
+        {
+            void const *end = std::memchr(data + ix, '\n', size - ix);
+            ix = end ? static_cast<char const *>(end) - data : size;
+            open = end == nullptr;
+        }
+        else if (c == '/' && next == '*')
+        {
+            // block comments nest
+            int comments = 1;
+            for (ix += 2; ix < size && comments > 0; ++ix)
+            {
+                if (data[ix] == '*' && ix + 1 < size && data[ix + 1] == '/')
+                {
+                    comments--;
+                    ix++;
+                }
+                else if (data[ix] == '/' && ix + 1 < size &&
+                         data[ix + 1] == '*')
+                {
+                    comments++;
+                    ix++;
+                }
+            }
+            open = comments > 0;
+        }
+        else if (c == '"')
+        {
+            void const *end = std::memchr(data + ix + 1, '"', size - ix - 1);
+            ix = end ? static_cast<char const *>(end) - data + 1 : size;
+            open = end == nullptr;
+        }
+        else
+        {
+            if (c == '{')
+            {
+                depth++;
+            }
+            else if (c == '}')
+            {
+                depth--;
+            }
+            else if (c == 'f' && next == 'n' &&
+                     (ix == 0 || !is_word(data[ix - 1])) &&
+                     (ix + 2 == size || !is_word(data[ix + 2])) &&
+                     ix - parts.back().begin >= min_size)
+            {
+                parts.back().end = ix;
+                parts.push_back({ix, 0});
+            }
+            ix++;
+        }
+    }
+    parts.back().end = size;
+    return {std::move(parts), depth == 0 && !open};
+}
+
+bool starts_part(std::string_view source, size_t begin)
+{
+    return source.substr(begin, 2) == "fn" &&
+           (begin == 0 || !is_word(source[begin - 1])) &&
+           (begin + 2 == source.size() || !is_word(source[begin + 2]));
+}
+
+Ast parse_parallel(
+    std::string_view source, common::Interner &interner, unsigned jobs
+)
+{
+    // a few parts per thread to even out differently sized functions
+    std::vector<SourcePart> parts =
+        split_source(source, source.size() / (jobs * 4) + 1).parts;
+
+    std::vector<Ast> trees(parts.size(), Ast(source));
+    // every part interns into its own table, see below
+    std::vector<common::Interner> names(parts.size());
+    std::vector<uint8_t> parsed(parts.size(), false);
+    std::atomic<size_t> next_part = 0;
+
+    auto work = [&]
+    {
+        error::Silence silence;
+        for (size_t ix = next_part++; ix < parts.size(); ix = next_part++)
+        {
+            SourcePart const &part = parts[ix];
+            try
+            {
+                Lexer lexer(source.substr(0, part.end), names[ix], part.begin);
+                Parser parser(lexer.lex(), source);
+                trees[ix] = parser.parse();
+                parsed[ix] = true;
+            }
+            catch (...)
+            {
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t ix = 1; ix < std::min<size_t>(jobs, parts.size()); ++ix)
+    {
+        threads.emplace_back(work);
+    }
+    work();
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    for (size_t ix = 0; ix < parts.size(); ++ix)
+    {
+        if (!parsed[ix])
+        {
+            Lexer lexer(source, interner);
+            Parser parser(lexer.lex(), source);
+            return parser.parse();
+        }
+    }
+
+    // Renumber the symbols of each part into the shared table. Parts are
+    // visited in source order and their own symbols are numbered by first
+    // use, so the IDs come out as the serial lexer would have assigned them.
+    std::vector<common::Symbol> remap;
+    for (size_t ix = 0; ix < parts.size(); ++ix)
+    {
+        remap.resize(names[ix].size());
+        for (common::Symbol symbol = 0; symbol < remap.size(); ++symbol)
+        {
+            remap[symbol] = interner.intern(names[ix].name(symbol));
+        }
+        for (Token &token : trees[ix].tokens)
+        {
+            if (token.kind == TokenType::Identifier)
+            {
+                token.value = remap[token.value];
+            }
+        }
+    }
+
+    Ast ast = std::move(trees[0]);
+    ast.append(std::span(trees).subspan(1));
+    return ast;
+}
@@ -0,0 +1,46 @@
+#ifndef FRONTEND_HPP
+#define FRONTEND_HPP
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "common/ast.hpp"
+#include "common/interner.hpp"
+
+// A part of a source starting at its top level, either at the very start
+// or in front of a `fn` keyword.
+struct SourcePart
+{
+    size_t begin;
+    size_t end;
+};
+
+struct SourceSplit
+{
+    std::vector<SourcePart> parts;
+    // false if the source ends inside braces, a comment or a string, i.e.
+    // whatever follows it would not start at the top level
+    bool ends_at_top_level;
+};
+
+// Splits `source` in front of `fn` keywords outside of any braces,
+// comments and strings, into parts of at least `min_size` bytes. This only
+// has to be right for sources that parse: a split anywhere else makes that
+// part fail to parse.
+SourceSplit split_source(std::string_view source, size_t min_size);
+// Whether a `fn` keyword starts at `begin`, which split_source() would
+// start a part at if `begin` lies at the top level.
+bool starts_part(std::string_view source, size_t begin);
+
+// Lexes and parses `source` on up to `jobs` threads. The source is split in
+// front of top-level `fn` declarations, the parts are parsed concurrently
+// and their trees joined in source order. If any part fails, the whole
+// source is parsed again serially, so diagnostics are exactly those of the
+// serial front end. Identifiers are interned into `interner` in the same
+// order the serial lexer would intern them.
+Ast parse_parallel(
+    std::string_view source, common::Interner &interner, unsigned jobs
+);
+
+#endif
@@ -0,0 +1,280 @@
+#include "gvn.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "cfg.hpp"
+#include "common/interner.hpp"
+#include "common/irinstructions.hpp"
+#include "ssa.hpp"
+
+namespace
+{
+uint64_t key(Operand operand)
+{
+    return static_cast<uint64_t>(operand.kind) << 32 | operand.id;
+}
+
+// An operator applied to operands, `right` being none for unary ones.
+struct Expression
+{
+    IROp op;
+    Operand left;
+    Operand right;
+
+    bool operator==(Expression const &other) const = default;
+};
+
+struct ExpressionHash
+{
+    size_t operator()(Expression const &expr) const
+    {
+        uint64_t hash = key(expr.left) * 0x9e3779b97f4a7c15 ^ key(expr.right);
+        return std::hash<uint64_t>()(
+            hash * 31 + static_cast<uint64_t>(expr.op)
+        );
+    }
+};
+
+// The form equal computations share: the operands of commutative
+// operators in a fixed order, and comparisons turned to look the same way.
+Expression normalize(Expression expr)
+{
+    switch (expr.op)
+    {
+    case IROp::Greater:
+        expr.op = IROp::Less;
+        std::swap(expr.left, expr.right);
+        break;
+    case IROp::GreaterEqual:
+        expr.op = IROp::LessEqual;
+        std::swap(expr.left, expr.right);
+        break;
+    case IROp::Add:
+    case IROp::Mul:
+    case IROp::Equal:
+    case IROp::NotEqual:
+        if (key(expr.right) < key(expr.left))
+        {
+            std::swap(expr.left, expr.right);
+        }
+        break;
+    default:
+        break;
+    }
+    return expr;
+}
+
+class ValueNumbering
+{
+   public:
+    ValueNumbering(CFG &cfg, std::span<common::Symbol const> promoted)
+        : m_cfg(cfg), m_promoted(promoted.begin(), promoted.end())
+    {
+    }
+
+    size_t run();
+
+   private:
+    // Whether an operand holds the same value wherever it is read.
+    bool is_stable(Operand operand) const
+    {
+        return is_ssa_value(operand) || operand.is_immediate() ||
+               (operand.kind == OperandKind::Var &&
+                m_promoted.contains(operand.id));
+    }
+    // The value replacing `operand`, or `operand` if none does.
+    Operand resolve(Operand operand) const;
+    // Drops the instruction, reading `value` for what it defined.
+    void replace(IRInstr &instr, Operand value);
+    void visit(uint32_t block);
+
+    CFG &m_cfg;
+    std::unordered_set<common::Symbol> m_promoted;
+    std::unordered_map<uint32_t, Operand> m_replaced;
+    // the values computed in the blocks dominating the one visited
+    std::unordered_map<Expression, Operand, ExpressionHash> m_available;
+    // the expressions made available, in order, to be dropped again on
+    // leaving the blocks computing them
+    std::vector<Expression> m_scope;
+    size_t m_removed = 0;
+};
+
+Operand ValueNumbering::resolve(Operand operand) const
+{
+    // phis may be replaced by values that are replaced later on
+    while (is_ssa_value(operand))
+    {
+        auto it = m_replaced.find(operand.id);
+        if (it == m_replaced.end())
+        {
+            break;
+        }
+        operand = it->second;
+    }
+    return operand;
+}
+
+void ValueNumbering::replace(IRInstr &instr, Operand value)
+{
+    // copies and phis would mostly be coalesced away anyway
+    if (instr.kind == IRType::BinaryOp || instr.kind == IRType::UnaryOp)
+    {
+        ++m_removed;
+    }
+    m_replaced[instr.dst()->id] = value;
+    instr = IRInstr();
+}
+
+void ValueNumbering::visit(uint32_t block)
+{
+    IRFunction &func = m_cfg.function();
+    std::vector<IRInstr> &code = m_cfg.block(block).code;
+    auto resolve_use = [&](Operand &use) { use = resolve(use); };
+    size_t first_phi = code.size();
+    for (size_t ix = 0; ix < code.size(); ++ix)
+    {
+        IRInstr &instr = code[ix];
+        if (instr.kind == IRType::Phi)
+        {
+            first_phi = std::min(first_phi, ix);
+            // values coming through back edges are not known yet
+            std::span<Operand> args = func.args(instr.variant.phi);
+            std::for_each(args.begin(), args.end(), resolve_use);
+
+            Operand dst = instr.variant.phi.dst;
+            Operand joined;
+            bool same = true;
+            for (Operand arg : args)
+            {
+                if (arg.is_none() || arg == dst)
+                {
+                    continue;
+                }
+                same = same && (joined.is_none() || arg == joined);
+                joined = arg;
+            }
+            if (same && !joined.is_none())
+            {
+                replace(instr, joined);
+                continue;
+            }
+            for (size_t other = first_phi; other < ix; ++other)
+            {
+                IRInstr const &earlier = code[other];
+                if (earlier.kind == IRType::Phi &&
+                    std::ranges::equal(func.args(earlier.variant.phi), args))
+                {
+                    replace(instr, earlier.variant.phi.dst);
+                    break;
+                }
+            }
+            continue;
+        }
+
+        func.for_each_use(instr, resolve_use);
+        Operand *dst = instr.dst();
+        if (dst == nullptr || !is_ssa_value(*dst))
+        {
+            continue;
+        }
+        Expression expr;
+        switch (instr.kind)
+        {
+        case IRType::Assign:
+            if (is_stable(instr.variant.assign.src))
+            {
+                replace(instr, instr.variant.assign.src);
+            }
+            continue;
+        case IRType::BinaryOp:
+            expr = {
+                instr.variant.binaryOp.op, instr.variant.binaryOp.left,
+                instr.variant.binaryOp.right
+            };
+            break;
+        case IRType::UnaryOp:
+            expr = {
+                instr.variant.unaryOp.op, instr.variant.unaryOp.value,
+                Operand()
+            };
+            break;
+        default:
+            continue;
+        }
+        if (!is_stable(expr.left) ||
+            !(expr.right.is_none() || is_stable(expr.right)))
+        {
+            continue;
+        }
+        expr = normalize(expr);
+        auto [it, added] = m_available.try_emplace(expr, *dst);
+        if (added)
+        {
+            m_scope.push_back(expr);
+        }
+        else
+        {
+            replace(instr, it->second);
+        }
+    }
+    std::erase_if(
+        code, [](IRInstr const &instr) { return instr.kind == IRType::Nop; }
+    );
+}
+
+size_t ValueNumbering::run()
+{
+    struct Frame
+    {
+        uint32_t block;
+        size_t child;
+        size_t scope;
+    };
+    std::vector<Frame> path = {{CFG::entry, 0, 0}};
+    visit(CFG::entry);
+    while (!path.empty())
+    {
+        Frame &frame = path.back();
+        std::span<uint32_t const> children = m_cfg.dom_children(frame.block);
+        if (frame.child < children.size())
+        {
+            uint32_t child = children[frame.child++];
+            path.push_back({child, 0, m_scope.size()});
+            visit(child);
+            continue;
+        }
+        for (size_t ix = frame.scope; ix < m_scope.size(); ++ix)
+        {
+            m_available.erase(m_scope[ix]);
+        }
+        m_scope.resize(frame.scope);
+        path.pop_back();
+    }
+
+    // the phi arguments read through back edges
+    IRFunction &func = m_cfg.function();
+    auto resolve_use = [&](Operand &use) { use = resolve(use); };
+    for (uint32_t block : m_cfg.reverse_postorder())
+    {
+        for (IRInstr &instr : m_cfg.phis(block))
+        {
+            func.for_each_use(instr, resolve_use);
+        }
+    }
+    return m_removed;
+}
+}  // namespace
+
+size_t number_values(CFG &cfg, std::span<common::Symbol const> promoted)
+{
+    ValueNumbering numbering(cfg, promoted);
+    return numbering.run();
+}
@@ -0,0 +1,21 @@
+#ifndef GVN_HPP
+#define GVN_HPP
+
+#include <cstddef>
+#include <span>
+
+#include "cfg.hpp"
+#include "common/interner.hpp"
+
+// Global value numbering over code in SSA form. Walks the dominator tree,
+// so a computation is replaced by an equal one that dominates it, in the
+// same block or another. Operands are compared after the replacements so
+// far, and in a fixed order for commutative operators, so `i + 1` matches
+// `1 + i`, and `a > b` matches `b < a`. Copies between values and phis
+// joining one value are replaced by that value too. Only values,
+// immediates and the variables `promoted` to SSA form by construct_ssa()
+// are compared, as other memory may change in between. Returns how many
+// computations were removed, not counting copies and phis.
+size_t number_values(CFG &cfg, std::span<common::Symbol const> promoted);
+
+#endif
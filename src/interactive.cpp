@@ -0,0 +1,410 @@
+#include "interactive.hpp"
+
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "common/error.hpp"
+#include "common/source.hpp"
+#include "document.hpp"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// The fields of a request. Only flat objects of strings and integers are
+// understood, which is all the protocol uses; other values are skipped.
+struct Request
+{
+    std::unordered_map<std::string, std::string> strings;
+    std::unordered_map<std::string, int64_t> numbers;
+};
+
+class RequestReader
+{
+   public:
+    RequestReader(std::string_view text) : m_text(text), m_pos(0) {}
+
+    bool read(Request &request)
+    {
+        if (!consume('{'))
+        {
+            return false;
+        }
+        if (consume('}'))
+        {
+            return at_end();
+        }
+
+        do
+        {
+            std::string key;
+            if (!read_string(key) || !consume(':'))
+            {
+                return false;
+            }
+
+            skip_space();
+            char c = m_pos < m_text.size() ? m_text[m_pos] : '\0';
+            if (c == '"')
+            {
+                if (!read_string(request.strings[key]))
+                {
+                    return false;
+                }
+            }
+            else if (c == '-' || (c >= '0' && c <= '9'))
+            {
+                int64_t &number = request.numbers[key];
+                auto [end, ec] = std::from_chars(
+                    m_text.data() + m_pos, m_text.data() + m_text.size(),
+                    number
+                );
+                if (ec != std::errc())
+                {
+                    return false;
+                }
+                m_pos = end - m_text.data();
+            }
+            else if (!skip_word("true") && !skip_word("false") &&
+                     !skip_word("null"))
+            {
+                return false;
+            }
+        } while (consume(','));
+
+        return consume('}') && at_end();
+    }
+
+   private:
+    std::string_view m_text;
+    size_t m_pos;
+
+    void skip_space()
+    {
+        while (m_pos < m_text.size() &&
+               (m_text[m_pos] == ' ' || m_text[m_pos] == '\t' ||
+                m_text[m_pos] == '\r' || m_text[m_pos] == '\n'))
+        {
+            m_pos++;
+        }
+    }
+
+    bool at_end()
+    {
+        skip_space();
+        return m_pos == m_text.size();
+    }
+
+    bool consume(char expected)
+    {
+        skip_space();
+        if (m_pos < m_text.size() && m_text[m_pos] == expected)
+        {
+            m_pos++;
+            return true;
+        }
+        return false;
+    }
+
+    bool skip_word(std::string_view word)
+    {
+        if (m_text.substr(m_pos).starts_with(word))
+        {
+            m_pos += word.size();
+            return true;
+        }
+        return false;
+    }
+
+    bool read_hex(uint32_t &code)
+    {
+        if (m_pos + 4 > m_text.size())
+        {
+            return false;
+        }
+        auto [end, ec] = std::from_chars(
+            m_text.data() + m_pos, m_text.data() + m_pos + 4, code, 16
+        );
+        if (ec != std::errc() || end != m_text.data() + m_pos + 4)
+        {
+            return false;
+        }
+        m_pos += 4;
+        return true;
+    }
+
+    static void append_utf8(std::string &out, uint32_t code)
+    {
+        if (code < 0x80)
+        {
+            out += static_cast<char>(code);
+        }
+        else if (code < 0x800)
+        {
+            out += static_cast<char>(0xc0 | code >> 6);
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        }
+        else if (code < 0x10000)
+        {
+            out += static_cast<char>(0xe0 | code >> 12);
+            out += static_cast<char>(0x80 | (code >> 6 & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        }
+        else
+        {
+            out += static_cast<char>(0xf0 | code >> 18);
+            out += static_cast<char>(0x80 | (code >> 12 & 0x3f));
+            out += static_cast<char>(0x80 | (code >> 6 & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        }
+    }
+
+    bool read_string(std::string &out)
+    {
+        if (!consume('"'))
+        {
+            return false;
+        }
+
+        while (m_pos < m_text.size())
+        {
+            char c = m_text[m_pos++];
+            if (c == '"')
+            {
+                return true;
+            }
+            if (c != '\\')
+            {
+                out += c;
+                continue;
+            }
+            if (m_pos == m_text.size())
+            {
+                return false;
+            }
+
+            switch (m_text[m_pos++])
+            {
+            case '"':
+                out += '"';
+                break;
+            case '\\':
+                out += '\\';
+                break;
+            case '/':
+                out += '/';
+                break;
+            case 'b':
+                out += '\b';
+                break;
+            case 'f':
+                out += '\f';
+                break;
+            case 'n':
+                out += '\n';
+                break;
+            case 'r':
+                out += '\r';
+                break;
+            case 't':
+                out += '\t';
+                break;
+            case 'u':
+            {
+                uint32_t code;
+                if (!read_hex(code))
+                {
+                    return false;
+                }
+                // A surrogate pair encodes a code point beyond 16 bits. A
+                // surrogate without its other half becomes U+FFFD, and
+                // whatever follows it is read on its own.
+                if (code >= 0xd800 && code < 0xe000)
+                {
+                    size_t next = m_pos;
+                    uint32_t low;
+                    if (code < 0xdc00 && skip_word("\\u") && read_hex(low) &&
+                        low >= 0xdc00 && low < 0xe000)
+                    {
+                        code = 0x10000 + ((code - 0xd800) << 10) +
+                               (low - 0xdc00);
+                    }
+                    else
+                    {
+                        m_pos = next;
+                        code = 0xfffd;
+                    }
+                }
+                append_utf8(out, code);
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        return false;
+    }
+};
+
+void append_string(std::string &out, std::string_view text)
+{
+    static constexpr char hex[] = "0123456789abcdef";
+
+    out += '"';
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += c;
+        }
+        else if (c == '\n')
+        {
+            out += "\\n";
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            out += "\\u00";
+            out += hex[c >> 4];
+            out += hex[c & 0xf];
+        }
+        else
+        {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+std::string error_response(std::string_view message)
+{
+    std::string response = "{\"error\": ";
+    append_string(response, message);
+    response += "}";
+    return response;
+}
+
+std::string response(
+    Document &document, Document::EditStats stats, Clock::time_point start
+)
+{
+    std::string diagnostics;
+    for (error::Diagnostic const &error : document.diagnostics())
+    {
+        common::LineColumn location = document.decode(error.offset);
+        diagnostics += diagnostics.empty() ? "" : ", ";
+        diagnostics += "{\"line\": " + std::to_string(location.line) +
+                       ", \"column\": " + std::to_string(location.column) +
+                       ", \"message\": ";
+        append_string(diagnostics, error.message);
+        diagnostics += "}";
+    }
+
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - start
+    );
+    return "{\"parts\": " + std::to_string(stats.parts) +
+           ", \"reparsed\": " + std::to_string(stats.reparsed) +
+           ", \"reanalyzed\": " + std::to_string(stats.reanalyzed) +
+           ", \"micros\": " + std::to_string(micros.count()) +
+           ", \"diagnostics\": [" + diagnostics + "]}";
+}
+
+// Reads the file a request names, or the text it gives.
+bool open_text(Request &request, std::string &text, std::string &failure)
+{
+    auto path = request.strings.find("path");
+    if (path == request.strings.end())
+    {
+        text = std::move(request.strings["text"]);
+        return true;
+    }
+
+    // failures are reported through error::fatal
+    std::vector<error::Diagnostic> errors;
+    error::Capture capture(errors);
+    try
+    {
+        common::SourceBuffer buffer(path->second);
+        text = buffer.text();
+        return true;
+    }
+    catch (error::Fatal const &)
+    {
+        failure = errors.empty() ? "Failed to open file" : errors[0].message;
+        return false;
+    }
+}
+}  // namespace
+
+void serve(std::istream &in, std::ostream &out)
+{
+    std::unique_ptr<Document> document;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        auto start = Clock::now();
+        Request request;
+        if (!RequestReader(line).read(request))
+        {
+            out << error_response("Malformed request") << std::endl;
+            continue;
+        }
+
+        std::string const &method = request.strings["method"];
+        if (method == "exit")
+        {
+            break;
+        }
+        else if (method == "open")
+        {
+            std::string text;
+            std::string failure;
+            if (!open_text(request, text, failure))
+            {
+                out << error_response(failure) << std::endl;
+                continue;
+            }
+
+            document = std::make_unique<Document>(std::move(text));
+            size_t parts = document->part_count();
+            out << response(*document, {parts, parts, parts}, start)
+                << std::endl;
+        }
+        else if (method == "edit")
+        {
+            if (document == nullptr)
+            {
+                out << error_response("No document is open") << std::endl;
+                continue;
+            }
+
+            int64_t offset = request.numbers["offset"];
+            int64_t removed = request.numbers["remove"];
+            int64_t size = document->text().size();
+            if (offset < 0 || removed < 0 || offset > size ||
+                removed > size - offset)
+            {
+                out << error_response("Edit out of range") << std::endl;
+                continue;
+            }
+
+            auto stats =
+                document->edit(offset, removed, request.strings["insert"]);
+            out << response(*document, stats, start) << std::endl;
+        }
+        else
+        {
+            out << error_response("Unknown method") << std::endl;
+        }
+    }
+}
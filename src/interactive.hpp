@@ -0,0 +1,24 @@
+#ifndef INTERACTIVE_HPP
+#define INTERACTIVE_HPP
+
+#include <istream>
+#include <ostream>
+
+// Serves editor diagnostics over `in` and `out`, one JSON object per line
+// each way. Requests are
+//
+//   {"method": "open", "path": "file.cp"}  or  {"method": "open", "text": ...}
+//   {"method": "edit", "offset": 120, "remove": 3, "insert": "x + 1"}
+//   {"method": "exit"}
+//
+// with byte offsets into the current text. Opens and edits are answered
+// with all diagnostics of the document, how much of it was parsed and
+// analyzed again, and the time that took in microseconds:
+//
+//   {"parts": 9, "reparsed": 1, "reanalyzed": 1, "micros": 85,
+//    "diagnostics": [{"line": 3, "column": 7, "message": "..."}]}
+//
+// A request that cannot be carried out is answered with {"error": "..."}.
+void serve(std::istream &in, std::ostream &out);
+
+#endif
@@ -1,183 +1,266 @@
 #include "irgenerator.hpp"
 
-#include <memory>
+#include <algorithm>
+#include <cctype>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#include "common/ast.hpp"
 #include "common/error.hpp"
+#include "common/traversal.hpp"
 
-std::pair<
-    std::vector<std::unique_ptr<IRInstr>>,
-    std::unordered_map<std::string, IRFunction>>
-IRGenerator::generate(std::vector<std::unique_ptr<Stmt>> const &statements)
+IRProgram IRGenerator::generate()
 {
-    for (auto const &stmt : statements)
-    {
-        lower_stmt(*stmt);
-    }
+    walk(m_ast, m_ast.statements, *this);
 
-    return {std::move(m_context.main), std::move(m_context.functions)};
+    IRProgram program = std::move(m_context.program);
+    m_context.program = IRProgram();
+    m_context.function_index.clear();
+    return program;
 }
 
-std::string IRGenerator::lower_expr(Expr const &expr)
+static IROp binary_op(TokenType kind)
 {
-    switch (expr.kind)
-    {
-    case ExprType::Literal:
-    {
-        auto &lit = expr.variant.literal;
-        std::string temp = m_context.new_temp();
-        m_context.emit_main(
-            std::make_unique<IRInstr>(AssignIR(temp, lit.token.lexeme))
-        );
-        return temp;
-    }
-    case ExprType::Var:
-    {
-        auto &var = expr.variant.var;
-        return var.var.token.lexeme;
-    }
-    case ExprType::Assign:
-    {
-        auto &assign = expr.variant.assign;
-        std::string rhs = lower_expr(*assign.expr);
-        std::string name = assign.var.token.lexeme;
-        m_context.emit_main(std::make_unique<IRInstr>(AssignIR(name, rhs)));
-        return name;
-    }
-    case ExprType::Binary:
+    switch (kind)
     {
-        auto &bin = expr.variant.binary;
-        std::string lhs = lower_expr(*bin.left);
-        std::string rhs = lower_expr(*bin.right);
-        std::string temp = m_context.new_temp();
-        m_context.emit_main(
-            std::make_unique<IRInstr>(BinaryOpIR(temp, lhs, bin.op.lexeme, rhs))
-        );
-        return temp;
+    case TokenType::Plus:
+        return IROp::Add;
+    case TokenType::Minus:
+        return IROp::Sub;
+    case TokenType::Star:
+        return IROp::Mul;
+    case TokenType::Slash:
+        return IROp::Div;
+    case TokenType::EqualEqual:
+        return IROp::Equal;
+    case TokenType::BangEqual:
+        return IROp::NotEqual;
+    case TokenType::Less:
+        return IROp::Less;
+    case TokenType::LessEqual:
+        return IROp::LessEqual;
+    case TokenType::Greater:
+        return IROp::Greater;
+    case TokenType::GreaterEqual:
+        return IROp::GreaterEqual;
+    case TokenType::BoolAnd:
+        return IROp::And;
+    case TokenType::BoolOr:
+        return IROp::Or;
+    default:
+        error::unreachable();
+        return IROp::Add;
     }
-    case ExprType::Unary:
+}
+
+// Whether a variable of this name would be spelled like a temporary or a
+// label in the output.
+static bool looks_generated(std::string_view name)
+{
+    return name.size() > 1 && (name[0] == 't' || name[0] == 'L') &&
+           std::all_of(
+               name.begin() + 1, name.end(),
+               [](unsigned char c) { return isdigit(c); }
+           );
+}
+
+Operand IRGenerator::pop_value()
+{
+    Operand value = m_values.back();
+    m_values.pop_back();
+    return value;
+}
+
+// Every declaration gets storage of its own. The first variable of a name
+// is stored under that name, later ones get a numbered copy of it, as do
+// those whose name could be taken for a temporary or label.
+Operand IRGenerator::declare(TokenRef name, Binding binding)
+{
+    common::Symbol symbol = m_ast.symbol(name);
+    if (symbol >= m_named.size())
     {
-        auto &un = expr.variant.unary;
-        std::string val = lower_expr(*un.expr);
-        std::string temp = m_context.new_temp();
-        m_context.emit_main(
-            std::make_unique<IRInstr>(UnaryOpIR(temp, un.op.lexeme, val))
-        );
-        return temp;
+        m_named.resize(symbol + 1);
     }
-    case ExprType::Grouping:
+    std::string_view lexeme = m_ast.lexeme(name);
+    Operand storage = Operand::var(
+        m_named[symbol] || looks_generated(lexeme) ? m_context.new_var(lexeme)
+                                                   : symbol
+    );
+    m_named[symbol] = true;
+
+    std::vector<Operand> &frame = m_frames[binding.depth];
+    if (binding.slot >= frame.size())
     {
-        return lower_expr(*expr.variant.grouping.expr);
+        frame.resize(binding.slot + 1);
     }
-    case ExprType::Call:
-    {
-        auto &call = expr.variant.call;
+    frame[binding.slot] = storage;
+    return storage;
+}
 
-        std::string func = lower_expr(*expr.variant.call.callee);
+void IRGenerator::enter(LiteralExpr const &expr, ExprRef)
+{
+    Operand temp = m_context.new_temp();
+    Operand value = Operand::immediate(expr.value, m_context.names);
+    m_context.emit(AssignIR(temp, value));
+    m_values.push_back(temp);
+}
 
-        std::vector<std::string> args;
-        for (auto &arg : call.args)
-        {
-            args.push_back(lower_expr(*arg));
-        }
+void IRGenerator::enter(VarExpr const &expr, ExprRef)
+{
+    // callees are not resolved, they name a function
+    m_values.push_back(
+        expr.binding.is_none()
+            ? Operand::func(m_ast.symbol(expr.name))
+            : m_frames[expr.binding.depth][expr.binding.slot]
+    );
+}
 
-        std::string dst = m_context.new_temp();
-        m_context.emit_main(std::make_unique<IRInstr>(CallIR(dst, func, args)));
-        return dst;
-        break;
-    }
-    }
+void IRGenerator::leave(AssignExpr const &expr, ExprRef)
+{
+    Operand rhs = pop_value();
+    Operand name = m_frames[expr.binding.depth][expr.binding.slot];
+    m_context.emit(AssignIR(name, rhs));
+    m_values.push_back(name);
+}
 
-    error::unreachable();
-    return "";
+void IRGenerator::leave(BinaryExpr const &expr, ExprRef)
+{
+    Operand rhs = pop_value();
+    Operand lhs = pop_value();
+    Operand temp = m_context.new_temp();
+    m_context.emit(BinaryOpIR(temp, lhs, binary_op(expr.op), rhs));
+    m_values.push_back(temp);
 }
 
-void IRGenerator::lower_stmt(Stmt const &stmt)
+void IRGenerator::leave(UnaryExpr const &expr, ExprRef)
 {
-    switch (stmt.kind)
-    {
-    case StmtType::Expr:
-    {
-        lower_expr(*stmt.variant.expr.expr);
-        break;
-    }
-    case StmtType::Print:
-    {
-        std::string val = lower_expr(*stmt.variant.print.expr);
-        m_context.emit_main(std::make_unique<IRInstr>(PrintIR(val)));
-        break;
-    }
-    case StmtType::Var:
-    {
-        std::string val = lower_expr(*stmt.variant.var.expr);
-        std::string name = stmt.variant.var.var.token.lexeme;
-        m_context.emit_main(std::make_unique<IRInstr>(AssignIR(name, val)));
-        break;
-    }
-    case StmtType::Block:
+    Operand val = pop_value();
+    Operand temp = m_context.new_temp();
+    IROp op = expr.op == TokenType::Minus ? IROp::Neg : IROp::Not;
+    m_context.emit(UnaryOpIR(temp, op, val));
+    m_values.push_back(temp);
+}
+
+void IRGenerator::leave(CallExpr const &expr, ExprRef)
+{
+    auto first = m_values.end() - expr.arg_count;
+    Operand func = first[-1];
+    Operand dst = m_context.new_temp();
+    m_context.current().emit_call(
+        dst, func, std::span<Operand const>(first, m_values.end())
+    );
+    m_values.erase(first - 1, m_values.end());
+    m_values.push_back(dst);
+}
+
+void IRGenerator::leave(ExprStmt const &, StmtRef) { m_values.pop_back(); }
+
+void IRGenerator::leave(PrintStmt const &, StmtRef)
+{
+    m_context.emit(PrintIR(pop_value()));
+}
+
+void IRGenerator::leave(VarStmt const &stmt, StmtRef)
+{
+    // a variable without initializer starts out as 0
+    Operand val = stmt.expr.is_none() ? Operand::immediate(0, m_context.names)
+                                      : pop_value();
+    Operand name = declare(stmt.var.token, stmt.var.binding);
+    m_context.current().locals.push_back(name);
+    m_context.emit(AssignIR(name, val));
+}
+
+void IRGenerator::after(IfStmt const &, StmtRef, uint32_t ix)
+{
+    if (ix == 0)
     {
-        for (auto &sub : stmt.variant.block.statements)
-        {
-            lower_stmt(*sub);
-        }
-        break;
+        Operand cond = pop_value();
+        Operand elseLabel = m_context.new_label();
+        Operand endLabel = m_context.new_label();
+
+        m_context.emit(IfFalseGotoIR(cond, elseLabel));
+        m_labels.push_back(elseLabel);
+        m_labels.push_back(endLabel);
     }
-    case StmtType::If:
+    else if (ix == 1)
     {
-        auto &if_ = stmt.variant.if_;
-        std::string cond = lower_expr(*if_.condition);
-        std::string elseLabel = m_context.new_label();
-        std::string endLabel = m_context.new_label();
-
-        m_context.emit_main(
-            std::make_unique<IRInstr>(IfFalseGotoIR(cond, elseLabel))
-        );
-        lower_stmt(*if_.then_branch);
-        m_context.emit_main(std::make_unique<IRInstr>(GotoIR(endLabel)));
-        m_context.emit_main(std::make_unique<IRInstr>(LabelIR(elseLabel)));
-        if (if_.else_branch)
-            lower_stmt(*if_.else_branch.get());
-        m_context.emit_main(std::make_unique<IRInstr>(LabelIR(endLabel)));
-        break;
+        Operand endLabel = m_labels.back();
+        Operand elseLabel = m_labels[m_labels.size() - 2];
+        m_context.emit(GotoIR(endLabel));
+        m_context.emit(LabelIR(elseLabel));
     }
-    case StmtType::While:
+}
+
+void IRGenerator::leave(IfStmt const &, StmtRef)
+{
+    m_context.emit(LabelIR(m_labels.back()));
+    m_labels.resize(m_labels.size() - 2);
+}
+
+void IRGenerator::enter(WhileStmt const &, StmtRef)
+{
+    Operand startLabel = m_context.new_label();
+    Operand endLabel = m_context.new_label();
+
+    m_context.emit(LabelIR(startLabel));
+    m_labels.push_back(startLabel);
+    m_labels.push_back(endLabel);
+}
+
+void IRGenerator::after(WhileStmt const &, StmtRef, uint32_t ix)
+{
+    if (ix == 0)
     {
-        auto &wh = stmt.variant.while_;
-        std::string startLabel = m_context.new_label();
-        std::string endLabel = m_context.new_label();
-
-        m_context.emit_main(std::make_unique<IRInstr>(LabelIR(startLabel)));
-        std::string cond = lower_expr(*wh.condition);
-        m_context.emit_main(
-            std::make_unique<IRInstr>(IfFalseGotoIR(cond, endLabel))
-        );
-        lower_stmt(*wh.body.get());
-        m_context.emit_main(std::make_unique<IRInstr>(GotoIR(startLabel)));
-        m_context.emit_main(std::make_unique<IRInstr>(LabelIR(endLabel)));
-        break;
+        Operand cond = pop_value();
+        m_context.emit(IfFalseGotoIR(cond, m_labels.back()));
     }
-    case StmtType::Func:
-    {
-        auto &fn = stmt.variant.func;
-        std::string funcLabel = "func_" + fn.name.lexeme;
+}
 
-        auto old_main = std::move(m_context.main);
+void IRGenerator::leave(WhileStmt const &, StmtRef)
+{
+    Operand endLabel = m_labels.back();
+    Operand startLabel = m_labels[m_labels.size() - 2];
+    m_context.emit(GotoIR(startLabel));
+    m_context.emit(LabelIR(endLabel));
+    m_labels.resize(m_labels.size() - 2);
+}
 
-        m_context.main.clear();
+void IRGenerator::enter(FuncStmt const &stmt, StmtRef)
+{
+    Operand funcLabel = Operand::func(m_ast.symbol(stmt.name));
 
-        m_context.emit_main(std::make_unique<IRInstr>(LabelIR(funcLabel)));
-        lower_stmt(*fn.body);
-        m_context.emit_main(std::make_unique<IRInstr>(ReturnIR("")));
+    IRFunction &func = m_context.open.emplace_back();
+    func.name = m_ast.symbol(stmt.name);
+    m_frames.emplace_back();
+    uint32_t depth = static_cast<uint32_t>(m_frames.size() - 1);
+    uint32_t slot = 0;
+    for (TokenRef param : m_ast.params(stmt))
+    {
+        func.params.push_back(declare(param, {depth, slot++}));
+    }
 
-        for (auto const &param : fn.params)
-        {
-            m_context.functions[fn.name.lexeme].params.push_back(param.lexeme);
-        }
+    m_context.emit(LabelIR(funcLabel));
+}
 
-        m_context.functions[fn.name.lexeme].body = std::move(m_context.main);
+void IRGenerator::leave(FuncStmt const &, StmtRef)
+{
+    m_context.emit(ReturnIR(Operand()));
+    m_frames.pop_back();
 
-        m_context.main = std::move(old_main);
-        break;
+    IRFunction func = std::move(m_context.open.back());
+    m_context.open.pop_back();
+    auto &functions = m_context.program.functions;
+    auto [it, added] =
+        m_context.function_index.try_emplace(func.name, functions.size());
+    if (added)
+    {
+        functions.push_back(std::move(func));
     }
+    else
+    {
+        functions[it->second] = std::move(func);
     }
 }
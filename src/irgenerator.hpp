@@ -1,62 +1,101 @@
 #ifndef IRGENERATOR_HPP
 #define IRGENERATOR_HPP
 
-#include <memory>
+#include <cstdint>
+#include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
+#include "common/ast.hpp"
+#include "common/interner.hpp"
 #include "common/expression.hpp"
 #include "common/statements.hpp"
 #include "common/irinstructions.hpp"
 
-struct IRFunction
-{
-    std::string name;
-    std::vector<std::string> params;
-    std::vector<std::unique_ptr<IRInstr>> body;
-};
-
 struct IRContext
 {
-    IRContext() = default;
-    IRContext(IRContext &ctx) = default;
+    IRContext(common::Interner &names) : names(names) {}
 
-    int temp_count = 0;
-    int label_count = 0;
+    // only the renamed copies of variables and wide immediates are
+    // interned, temporaries and labels are numbered
+    common::Interner &names;
+    // t0 is where the assembly reads the results of calls from, so no
+    // expression gets it
+    uint32_t temp_count = 1;
+    uint32_t label_count = 0;
+    uint32_t var_count = 0;
 
-    std::vector<std::unique_ptr<IRInstr>> main;
-    std::unordered_map<std::string, IRFunction> functions;
+    IRProgram program;
+    // index into program.functions by name, a redefinition replaces the
+    // function
+    std::unordered_map<common::Symbol, size_t> function_index;
+    // the functions being lowered, innermost last
+    std::vector<IRFunction> open;
 
-    std::string new_temp() { return "t" + std::to_string(temp_count++); }
-    std::string new_label() { return "L" + std::to_string(label_count++); }
-
-    void emit_main(std::unique_ptr<IRInstr> instr)
+    Operand new_temp() { return Operand::temp(temp_count++); }
+    Operand new_label() { return Operand::label(label_count++); }
+    // storage for a variable whose name is already taken by another one
+    common::Symbol new_var(std::string_view name)
     {
-        main.push_back(std::move(instr));
+        return names.intern_copy(
+            std::string(name) + "." + std::to_string(var_count++)
+        );
     }
 
-    void emit_func(const std::string &name, std::unique_ptr<IRInstr> instr)
-    {
-        functions[name].body.push_back(std::move(instr));
-    }
+    // the code being lowered
+    IRFunction &current() { return open.empty() ? program.main : open.back(); }
+    void emit(IRInstr instr) { current().emit(instr); }
 };
 
 class IRGenerator
 {
    public:
-    IRGenerator() : m_context(IRContext()) {};
+    IRGenerator(Ast const &ast, common::Interner &names)
+        : m_ast(ast), m_context(names), m_frames({{}}) {};
     ~IRGenerator() = default;
 
-    std::pair<
-        std::vector<std::unique_ptr<IRInstr>>,
-        std::unordered_map<std::string, IRFunction>>
-    generate(std::vector<std::unique_ptr<Stmt>> const &statements);
+    // Lowers the statements the tree holds now. In pipelined mode this is
+    // called once per top-level declaration, each time returning only the
+    // code of the new statements.
+    IRProgram generate();
+
+    // numbers the temporaries and labels passes add to the generated code
+    IRContext &context() { return m_context; }
 
-    std::string lower_expr(Expr const &expr);
-    void lower_stmt(Stmt const &stmt);
+    // traversal hooks, see walk(). Every expression leaves the operand
+    // holding its value on m_values.
+    void enter(LiteralExpr const &expr, ExprRef ref);
+    void enter(VarExpr const &expr, ExprRef ref);
+    void leave(AssignExpr const &expr, ExprRef ref);
+    void leave(BinaryExpr const &expr, ExprRef ref);
+    void leave(UnaryExpr const &expr, ExprRef ref);
+    void leave(CallExpr const &expr, ExprRef ref);
+
+    void leave(ExprStmt const &stmt, StmtRef ref);
+    void leave(PrintStmt const &stmt, StmtRef ref);
+    void leave(VarStmt const &stmt, StmtRef ref);
+    void after(IfStmt const &stmt, StmtRef ref, uint32_t ix);
+    void leave(IfStmt const &stmt, StmtRef ref);
+    void enter(WhileStmt const &stmt, StmtRef ref);
+    void after(WhileStmt const &stmt, StmtRef ref, uint32_t ix);
+    void leave(WhileStmt const &stmt, StmtRef ref);
+    void enter(FuncStmt const &stmt, StmtRef ref);
+    void leave(FuncStmt const &stmt, StmtRef ref);
 
    private:
+    Operand pop_value();
+    Operand declare(TokenRef name, Binding binding);
+
+    Ast const &m_ast;
     IRContext m_context;
+    std::vector<Operand> m_values;
+    // per function nesting level, the storage of the variable in each slot
+    std::vector<std::vector<Operand>> m_frames;
+    // per symbol, whether a variable of that name has been given storage
+    std::vector<bool> m_named;
+    // the else/end labels of enclosing ifs, start/end labels of loops
+    std::vector<Operand> m_labels;
 };
 
 #endif
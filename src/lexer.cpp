@@ -1,52 +1,262 @@
 #include "lexer.hpp"
 
-#include <cctype>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <string>
+#include <utility>
 #include <vector>
 #include "common/error.hpp"
 #include "common/token.hpp"
 
-Lexer::Lexer(std::string const &source)
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Character classes, looked up through a table instead of the locale
+// dependent <cctype> functions.
+enum CharClass : uint8_t
+{
+    Space = 1 << 0,    // ' ', '\t', '\r'
+    Newline = 1 << 1,  // '\n'
+    Digit = 1 << 2,    // '0'-'9'
+    Alpha = 1 << 3,    // 'a'-'z', 'A'-'Z', '_'
+};
+
+static constexpr std::array<uint8_t, 256> char_classes = []
+{
+    std::array<uint8_t, 256> table = {};
+    table[' '] = table['\t'] = table['\r'] = Space;
+    table['\n'] = Newline;
+    for (int c = '0'; c <= '9'; ++c)
+    {
+        table[c] = Digit;
+    }
+    for (int c = 'a'; c <= 'z'; ++c)
+    {
+        table[c] = table[c - 'a' + 'A'] = Alpha;
+    }
+    table['_'] = Alpha;
+    return table;
+}();
+
+static bool is_class(char c, uint8_t classes)
+{
+    return char_classes[static_cast<unsigned char>(c)] & classes;
+}
+
+// Keywords are found with a perfect hash over the first and last character
+// and the length of a word; the table is built and checked for collisions
+// at compile time.
+struct Keyword
+{
+    std::string_view text;
+    TokenType kind;
+};
+
+static constexpr size_t keyword_hash(std::string_view word)
+{
+    return (word.front() + word.back() + word.size()) & 31;
+}
+
+static constexpr std::array<Keyword, 32> keywords = []
+{
+    constexpr Keyword list[] = {
+        {"struct", TokenType::Struct}, {"else", TokenType::Else},
+        {"false", TokenType::False},   {"for", TokenType::For},
+        {"fn", TokenType::Fn},         {"if", TokenType::If},
+        {"print", TokenType::Print},   {"return", TokenType::Return},
+        {"true", TokenType::True},     {"let", TokenType::Let},
+        {"while", TokenType::While},
+    };
+
+    std::array<Keyword, 32> table = {};
+    for (Keyword const &keyword : list)
+    {
+        Keyword &slot = table[keyword_hash(keyword.text)];
+        if (!slot.text.empty())
+        {
+            throw "keyword hash collision";
+        }
+        slot = keyword;
+    }
+    return table;
+}();
+
+static TokenType keyword_or_ident(std::string_view word)
+{
+    Keyword const &keyword = keywords[keyword_hash(word)];
+    return keyword.text == word ? keyword.kind : TokenType::Identifier;
+}
+
+// The scan_* functions return the position of the first character at or
+// after `pos` that does not belong to the run. Full blocks are classified
+// with SIMD compares where available, the tail is finished byte by byte.
+#if defined(__AVX2__)
+using Block = __m256i;
+static constexpr size_t block_size = 32;
+
+static Block load(char const *p)
+{
+    return _mm256_loadu_si256(reinterpret_cast<Block const *>(p));
+}
+static Block splat(char c) { return _mm256_set1_epi8(c); }
+static Block eq(Block a, Block b) { return _mm256_cmpeq_epi8(a, b); }
+static Block gt(Block a, Block b) { return _mm256_cmpgt_epi8(a, b); }
+static Block both(Block a, Block b) { return _mm256_and_si256(a, b); }
+static Block either(Block a, Block b) { return _mm256_or_si256(a, b); }
+static uint32_t bits(Block a) { return _mm256_movemask_epi8(a); }
+#elif defined(__SSE2__)
+using Block = __m128i;
+static constexpr size_t block_size = 16;
+
+static Block load(char const *p)
+{
+    return _mm_loadu_si128(reinterpret_cast<Block const *>(p));
+}
+static Block splat(char c) { return _mm_set1_epi8(c); }
+static Block eq(Block a, Block b) { return _mm_cmpeq_epi8(a, b); }
+static Block gt(Block a, Block b) { return _mm_cmpgt_epi8(a, b); }
+static Block both(Block a, Block b) { return _mm_and_si128(a, b); }
+static Block either(Block a, Block b) { return _mm_or_si128(a, b); }
+static uint32_t bits(Block a) { return _mm_movemask_epi8(a); }
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+static constexpr uint32_t full_mask =
+    block_size == 32 ? ~0u : (1u << block_size) - 1;
+
+// Bytes within ['lo', 'hi']. Bytes >= 0x80 are negative in the signed
+// compares and therefore never in range.
+static Block in_range(Block block, char lo, char hi)
+{
+    return both(gt(block, splat(lo - 1)), gt(splat(hi + 1), block));
+}
+
+static uint32_t digit_bits(Block block)
+{
+    return bits(in_range(block, '0', '9'));
+}
+
+static uint32_t alnum_bits(Block block)
+{
+    Block lower = either(block, splat(0x20));
+    return bits(either(
+        either(in_range(lower, 'a', 'z'), in_range(block, '0', '9')),
+        eq(block, splat('_'))
+    ));
+}
+#endif
+
+static size_t scan_digits(std::string_view source, size_t pos)
+{
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; pos + block_size <= source.size(); pos += block_size)
+    {
+        uint32_t rest = ~digit_bits(load(source.data() + pos)) & full_mask;
+        if (rest != 0)
+        {
+            return pos + std::countr_zero(rest);
+        }
+    }
+#endif
+    while (pos < source.size() && is_class(source[pos], Digit))
+    {
+        pos++;
+    }
+    return pos;
+}
+
+static size_t scan_alnum(std::string_view source, size_t pos)
+{
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; pos + block_size <= source.size(); pos += block_size)
+    {
+        uint32_t rest = ~alnum_bits(load(source.data() + pos)) & full_mask;
+        if (rest != 0)
+        {
+            return pos + std::countr_zero(rest);
+        }
+    }
+#endif
+    while (pos < source.size() && is_class(source[pos], Alpha | Digit))
+    {
+        pos++;
+    }
+    return pos;
+}
+
+Lexer::Lexer(std::string_view source, common::Interner &interner)
+    : Lexer(source, interner, 0)
+{
+}
+
+Lexer::Lexer(
+    std::string_view source, common::Interner &interner, size_t offset
+)
     : m_had_error(false),
+      m_done(false),
       m_source(source),
+      m_interner(interner),
       m_tokens({}),
-      m_current(0),
-      m_line(1),
-      m_line_start(m_current - 1)
+      m_current(offset)
 {
-    keywords["struct"] = TokenType::Struct;
-    keywords["else"] = TokenType::Else;
-    keywords["false"] = TokenType::False;
-    keywords["for"] = TokenType::For;
-    keywords["fn"] = TokenType::Fn;
-    keywords["if"] = TokenType::If;
-    keywords["print"] = TokenType::Print;
-    keywords["return"] = TokenType::Return;
-    keywords["true"] = TokenType::True;
-    keywords["let"] = TokenType::Let;
-    keywords["while"] = TokenType::While;
 }
 
 Lexer::~Lexer() {}
 
 std::vector<Token> Lexer::lex()
 {
-    while (!is_at_end())
+    // Most tokens are a few characters long, this avoids regrowing the
+    // vector over and over on large inputs.
+    m_tokens.reserve(m_source.length() / 4 + 1);
+
+    while (!is_at_end() && !(m_had_error && error::limit_reached()))
     {
         m_start = m_current;
         lex_token();
     }
 
-    m_tokens.push_back(
-        Token(TokenType::Eof, "", Literal(), m_line, m_start - m_line_start)
-    );
+    add_eof_token();
+    return std::move(m_tokens);
+}
+
+std::vector<Token> const &Lexer::lex_chunk(size_t max_tokens)
+{
+    m_tokens.clear();
+
+    bool stop = false;
+    while (!is_at_end() && m_tokens.size() < max_tokens)
+    {
+        if (m_had_error && error::limit_reached())
+        {
+            stop = true;
+            break;
+        }
+        m_start = m_current;
+        lex_token();
+    }
+
+    if ((stop || is_at_end()) && !m_done)
+    {
+        add_eof_token();
+    }
+    return m_tokens;
+}
+
+bool Lexer::is_done() const { return m_done; }
+
+void Lexer::add_eof_token()
+{
+    m_done = true;
+    m_tokens.push_back(Token(TokenType::Eof, m_current, 0, 0));
 
     if (m_had_error)
     {
         error::fatal("Encountered an error during lexing pass");
     }
-    return m_tokens;
 }
 
 // TODO: add comments
@@ -54,6 +264,25 @@ void Lexer::lex_token()
 {
     char c = m_source[m_current];
 
+    // Runs of whitespace, numbers and identifiers are scanned in bulk, the
+    // remaining characters are all punctuation.
+    uint8_t classes = char_classes[static_cast<unsigned char>(c)];
+    if (classes & (Space | Newline))
+    {
+        skip_whitespace();
+        return;
+    }
+    if (classes & Digit)
+    {
+        add_num_token();
+        return;
+    }
+    if (classes & Alpha)
+    {
+        add_ident_token();
+        return;
+    }
+
     m_current++;
 
     switch (c)
@@ -82,10 +311,14 @@ void Lexer::lex_token()
     case '/':
         if (match('/'))
         {
-            while (peek() != '\n' && !is_at_end())
-            {
-                advance();
-            }
+            // the newline itself is left to skip_whitespace()
+            void const *end = std::memchr(
+                m_source.data() + m_current, '\n',
+                m_source.length() - m_current
+            );
+            m_current = end == nullptr
+                            ? m_source.length()
+                            : static_cast<char const *>(end) - m_source.data();
         }
         else if (match('*'))
         {
@@ -125,63 +358,76 @@ void Lexer::lex_token()
         break;
     case '^':
         add_token(TokenType::LogicXor);
-    case ' ':
-        break;
-    case '\n':
-        m_line++;
-        m_line_start = m_current - 1;
         break;
     default:
-        if (std::isdigit(c))
-        {
-            add_num_token();
-        }
-        else if (std::isalpha(c) || c == '_')
-        {
-            add_ident_token();
-        }
-        else
+        m_had_error = true;
+        error::report(
+            m_start, "Unexpected character (" + std::string(1, c) + ")"
+        );
+        break;
+    }
+}
+
+void Lexer::skip_whitespace()
+{
+    // Most runs are a single space between two tokens, which is cheaper to
+    // handle directly than by loading a whole block.
+    if (m_source[m_current] == ' ' &&
+        !is_class(peek_next(), Space | Newline))
+    {
+        m_current++;
+        return;
+    }
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    while (m_current + block_size <= m_source.length())
+    {
+        Block block = load(m_source.data() + m_current);
+        uint32_t spaces = bits(either(
+            either(eq(block, splat(' ')), eq(block, splat('\t'))),
+            either(eq(block, splat('\r')), eq(block, splat('\n')))
+        ));
+
+        uint32_t rest = ~spaces & full_mask;
+        m_current += rest == 0 ? block_size : std::countr_zero(rest);
+        if (rest != 0)
         {
-            m_had_error = true;
-            error::report(
-                static_cast<int>(m_line),
-                "Unexpected character (" + std::string(1, c) + ")"
-            );
-            break;
+            return;
         }
     }
+#endif
+
+    while (!is_at_end() && is_class(peek(), Space | Newline))
+    {
+        m_current++;
+    }
 }
 
-void Lexer::add_token(TokenType kind)
+void Lexer::add_token(TokenType kind, int64_t value)
 {
-    std::string lexeme = m_source.substr(m_start, m_current - m_start);
-    m_tokens.push_back(
-        Token(kind, lexeme, Literal(), m_line, m_start - m_line_start)
-    );
+    m_tokens.push_back(Token(kind, m_start, m_current - m_start, value));
 }
 
 void Lexer::add_num_token()
 {
-    while (std::isdigit(peek()))
+    // Values wrap around on overflow, just like the 64 bit arithmetic of
+    // the generated code.
+    size_t end = scan_digits(m_source, m_current);
+    uint64_t value = 0;
+    for (; m_current < end; ++m_current)
     {
-        advance();
+        value = value * 10 + (m_source[m_current] - '0');
     }
 
-    if (peek() == '.' && std::isdigit(peek_next()))
+    if (peek() == '.' && is_class(peek_next(), Digit))
     {
-        advance();
+        m_current = scan_digits(m_source, m_current + 1);
 
-        while (std::isdigit(peek()))
-        {
-            advance();
-        }
+        m_had_error = true;
+        error::report(m_start, "Only integer literals are supported");
     }
 
-    std::string lexeme = m_source.substr(m_start, m_current - m_start);
-    double num = std::stod(lexeme);
-    m_tokens.push_back(Token(
-        TokenType::Number, lexeme, Literal(num), m_line, m_start - m_line_start
-    ));
+    add_token(TokenType::Number, static_cast<int64_t>(value));
 }
 
 void Lexer::add_str_token()
@@ -191,26 +437,11 @@ void Lexer::add_str_token()
 
 void Lexer::add_ident_token()
 {
-    char c = peek();
-    while (std::isdigit(c) || isalpha(c) || c == '_')
-    {
-        advance();
-        c = peek();
-    }
-
-    std::string lexeme = m_source.substr(m_start, m_current - m_start);
-    TokenType type;
-    if (keywords.contains(lexeme))
-    {
-        type = keywords[lexeme];
-    }
-    else
-    {
-        type = TokenType::Identifier;
-    }
-
-    m_tokens.push_back(
-        Token(type, lexeme, Literal(), m_line, m_start - m_line_start)
+    m_current = scan_alnum(m_source, m_current);
+    std::string_view word = m_source.substr(m_start, m_current - m_start);
+    TokenType kind = keyword_or_ident(word);
+    add_token(
+        kind, kind == TokenType::Identifier ? m_interner.intern(word) : 0
     );
 }
 
@@ -251,14 +482,11 @@ char Lexer::peek_next()
 
 void Lexer::check_for_end_comment()
 {
-    int line = m_line;
+    // reported at the opening "/*"
+    size_t start = m_current - 2;
 
     while (!is_at_end())
     {
-        if (peek() == '\n')
-        {
-            m_line += 1;
-        }
         advance();
 
         if (peek() == '/' && peek_next() == '*')
@@ -275,6 +503,6 @@ void Lexer::check_for_end_comment()
         }
     }
 
-    error::report(line, "Unterminated multiline comment");
+    error::report(start, "Unterminated multiline comment");
     m_had_error = true;
 }
@@ -1,38 +1,51 @@
 #ifndef LEXER_HPP
 #define LEXER_HPP
 
+#include "common/interner.hpp"
 #include "common/token.hpp"
 
 #include <cstddef>
-#include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 
 class Lexer
 {
    public:
-    Lexer(std::string const &source);
+    // Identifiers are interned into `interner`, which has to outlive the
+    // tokens.
+    Lexer(std::string_view source, common::Interner &interner);
+    // Lexes `source` from `offset` on. Token offsets stay relative to the
+    // whole of `source`.
+    Lexer(
+        std::string_view source, common::Interner &interner, size_t offset
+    );
     ~Lexer();
 
     std::vector<Token> lex();
 
+    // Streaming mode: lexes up to `max_tokens` further tokens and returns
+    // them. The returned vector is reused by the next call, so only one
+    // chunk is ever held in memory. The final chunk ends with the Eof token.
+    std::vector<Token> const &lex_chunk(size_t max_tokens);
+    bool is_done() const;
+
    private:
     bool m_had_error;
-    std::string m_source;
+    bool m_done;
+    std::string_view m_source;
+    common::Interner &m_interner;
     std::vector<Token> m_tokens = {};
     size_t m_start;
     size_t m_current;
-    size_t m_line;
-    size_t m_line_start;
-
-    std::unordered_map<std::string, TokenType> keywords;
 
    private:
     void lex_token();
-    void add_token(TokenType kind);
+    void skip_whitespace();
+    void add_token(TokenType kind, int64_t value = 0);
     void add_num_token();
     void add_str_token();
     void add_ident_token();
+    void add_eof_token();
 
     bool is_at_end();
     char advance();
@@ -0,0 +1,188 @@
+#include "licm.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "cfg.hpp"
+#include "common/interner.hpp"
+#include "common/irinstructions.hpp"
+#include "ssa.hpp"
+
+namespace
+{
+// Whether an instruction does nothing but compute a value from its
+// operands.
+bool is_pure(IRInstr const &instr)
+{
+    bool computes = instr.kind == IRType::BinaryOp ||
+                    instr.kind == IRType::UnaryOp ||
+                    instr.kind == IRType::Assign;
+    return computes && is_ssa_value(*instr.dst());
+}
+
+// Whether an instruction may trap, which only a division by zero does, so
+// it can not be moved to where the loop may not have run it.
+bool may_trap(IRInstr const &instr)
+{
+    if (instr.kind != IRType::BinaryOp)
+    {
+        return false;
+    }
+    BinaryOpIR const &binary = instr.variant.binaryOp;
+    // wide immediates are never zero
+    Operand const zero{OperandKind::Imm, 0};
+    return binary.op == IROp::Div &&
+           (!binary.right.is_immediate() || binary.right == zero);
+}
+
+class Hoister
+{
+   public:
+    Hoister(CFG &cfg, std::span<common::Symbol const> promoted)
+        : m_cfg(cfg), m_promoted(promoted.begin(), promoted.end())
+    {
+    }
+
+    size_t run();
+
+   private:
+    // Moves what does not change in `loop` to its preheader.
+    void hoist(Loop const &loop);
+
+    CFG &m_cfg;
+    std::unordered_set<common::Symbol> m_promoted;
+    // the block defining each value, values defined on entry having none
+    std::unordered_map<uint32_t, uint32_t> m_def;
+    size_t m_hoisted = 0;
+};
+
+void Hoister::hoist(Loop const &loop)
+{
+    std::vector<bool> in_loop(m_cfg.size());
+    for (uint32_t block : loop.blocks)
+    {
+        in_loop[block] = true;
+    }
+    uint32_t preheader = no_block;
+    for (uint32_t pred : m_cfg.block(loop.header).preds)
+    {
+        if (!in_loop[pred])
+        {
+            preheader = pred;
+        }
+    }
+
+    // the variables in memory the loop may change
+    std::unordered_set<common::Symbol> written;
+    bool calls = false;
+    for (uint32_t block : loop.blocks)
+    {
+        for (IRInstr const &instr : m_cfg.block(block).code)
+        {
+            Operand const *dst = instr.dst();
+            if (dst != nullptr && dst->kind == OperandKind::Var)
+            {
+                written.insert(dst->id);
+            }
+            calls = calls || instr.kind == IRType::Call;
+        }
+    }
+    auto invariant = [&](Operand &operand)
+    {
+        if (operand.is_immediate())
+        {
+            return true;
+        }
+        if (is_ssa_value(operand))
+        {
+            auto def = m_def.find(operand.id);
+            return def == m_def.end() || !in_loop[def->second];
+        }
+        return operand.kind == OperandKind::Var &&
+               (m_promoted.contains(operand.id) ||
+                (!calls && !written.contains(operand.id)));
+    };
+
+    // in reverse postorder, so values are defined before they are read
+    IRFunction &func = m_cfg.function();
+    std::vector<IRInstr> moved;
+    for (uint32_t block : m_cfg.reverse_postorder())
+    {
+        if (!in_loop[block])
+        {
+            continue;
+        }
+        std::vector<IRInstr> &code = m_cfg.block(block).code;
+        std::vector<IRInstr> kept;
+        for (IRInstr &instr : code)
+        {
+            bool stays = false;
+            if (is_pure(instr))
+            {
+                func.for_each_use(
+                    instr,
+                    [&](Operand &use) { stays = stays || !invariant(use); }
+                );
+            }
+            if (!is_pure(instr) || stays || may_trap(instr))
+            {
+                kept.push_back(instr);
+                continue;
+            }
+            m_def[instr.dst()->id] = preheader;
+            moved.push_back(instr);
+        }
+        code = std::move(kept);
+    }
+
+    // the preheader only falls through to the header
+    std::vector<IRInstr> &code = m_cfg.block(preheader).code;
+    code.insert(code.end(), moved.begin(), moved.end());
+    m_hoisted += moved.size();
+}
+
+size_t Hoister::run()
+{
+    // adding the preheaders changes the loops
+    std::vector<uint32_t> headers;
+    for (Loop const &loop : m_cfg.loops())
+    {
+        headers.push_back(loop.header);
+    }
+    for (uint32_t header : headers)
+    {
+        m_cfg.add_preheader(header);
+    }
+
+    for (uint32_t block : m_cfg.reverse_postorder())
+    {
+        for (IRInstr &instr : m_cfg.block(block).code)
+        {
+            Operand const *dst = instr.dst();
+            if (dst != nullptr && is_ssa_value(*dst))
+            {
+                m_def[dst->id] = block;
+            }
+        }
+    }
+    // inner loops first
+    std::vector<Loop> loops(m_cfg.loops().begin(), m_cfg.loops().end());
+    for (auto loop = loops.rbegin(); loop != loops.rend(); ++loop)
+    {
+        hoist(*loop);
+    }
+    return m_hoisted;
+}
+}  // namespace
+
+size_t hoist_loop_invariants(
+    CFG &cfg, std::span<common::Symbol const> promoted
+)
+{
+    Hoister hoister(cfg, promoted);
+    return hoister.run();
+}
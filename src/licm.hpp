@@ -0,0 +1,23 @@
+#ifndef LICM_HPP
+#define LICM_HPP
+
+#include <cstddef>
+#include <span>
+
+#include "cfg.hpp"
+#include "common/interner.hpp"
+
+// Loop-invariant code motion over code in SSA form. Gives every loop a
+// preheader, see CFG::add_preheader(), and moves the computations and
+// copies in the loop whose operands do not change while it runs there,
+// inner loops first, so they may move on out of the loops around them.
+// Values and immediates do not change, nor do the variables `promoted` to
+// SSA form by construct_ssa(), and other variables only if the loop does
+// not write them and calls nothing. Code is moved even from paths the
+// loop may not take, except divisions that may trap. Returns how many
+// instructions were moved.
+size_t hoist_loop_invariants(
+    CFG &cfg, std::span<common::Symbol const> promoted
+);
+
+#endif
@@ -1,72 +1,182 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
 #include <iostream>
+#include <string>
+#include <string_view>
 
-#include "common/error.hpp"
-#include "asmgenerator.hpp"
-#include "irgenerator.hpp"
+#include "cminus.hpp"
 #include "common/common.hpp"
-#include "common/token.hpp"
-#include "lexer.hpp"
-#include "parser.hpp"
-#include "analyzer.hpp"
-#include "printer.hpp"
+#include "common/error.hpp"
+#include "common/output.hpp"
+#include "common/source.hpp"
+#include "interactive.hpp"
 
-#define DEBUG_TOKENS 0
-#define DEBUG_AST 1
+// Parses the comma separated stages of --emit=tokens,ast,ir,cfg,asm. The
+// assembly is printed here, the library only dumps the other stages.
+static void parse_emit(
+    std::string_view list, cminus::Options &options, bool &emit_asm
+)
+{
+    while (!list.empty())
+    {
+        std::string_view stage = list.substr(0, list.find(','));
+        list.remove_prefix(std::min(list.size(), stage.size() + 1));
+        if (stage == "tokens")
+        {
+            options.emit_tokens = true;
+        }
+        else if (stage == "ast")
+        {
+            options.emit_ast = true;
+        }
+        else if (stage == "ir")
+        {
+            options.emit_ir = true;
+        }
+        else if (stage == "cfg")
+        {
+            options.emit_cfg = true;
+        }
+        else if (stage == "asm")
+        {
+            emit_asm = true;
+        }
+        else
+        {
+            error::fatal("Unknown stage to emit: " + std::string(stage));
+        }
+    }
+}
 
 int main(int argc, char **argv)
 try
 {
+    // Reports problems with the command line and input file, in one go
+    // when it goes away, which also happens when a fatal error unwinds out
+    // of main(). Compilation reports into its own buffer.
+    error::DiagnosticEngine diagnostics(std::cout);
+
     // TODO: properly handle input
-    if (argc < 2)
+    cminus::Options options;
+    bool interactive = false;
+    bool emit_asm = false;
+    char const *path = nullptr;
+    for (int ix = 1; ix < argc; ++ix)
     {
-        error::fatal("No input files");
+        std::string_view arg = argv[ix];
+        if (arg == "--interactive")
+        {
+            interactive = true;
+        }
+        else if (arg == "--stream")
+        {
+            options.streaming = true;
+        }
+        else if (arg == "--pipeline")
+        {
+            options.pipelined = true;
+        }
+        else if (arg == "--optimize")
+        {
+            options.optimize = true;
+        }
+        else if (arg == "--time")
+        {
+            options.timing = true;
+        }
+        else if (arg.starts_with("--jobs="))
+        {
+            arg.remove_prefix(7);
+            auto [end, ec] = std::from_chars(
+                arg.data(), arg.data() + arg.size(), options.jobs
+            );
+            if (ec != std::errc() || end != arg.data() + arg.size() ||
+                options.jobs == 0)
+            {
+                error::fatal("Expected a positive number of jobs");
+            }
+        }
+        else if (arg.starts_with("--emit="))
+        {
+            parse_emit(arg.substr(7), options, emit_asm);
+        }
+        else if (arg.starts_with("--max-errors="))
+        {
+            arg.remove_prefix(13);
+            auto [end, ec] = std::from_chars(
+                arg.data(), arg.data() + arg.size(), options.max_errors
+            );
+            if (ec != std::errc() || end != arg.data() + arg.size())
+            {
+                error::fatal("Expected a number of errors");
+            }
+        }
+        else
+        {
+            path = argv[ix];
+        }
     }
 
-    std::string source = common::read_file(argv[1]);
-
-    Lexer lexer(source);
-    std::vector<Token> tokens = lexer.lex();
-
-#if DEBUG_TOKENS
-    std::cout << '\n';
-    for (Token const &token : tokens)
+    if (interactive)
     {
-        token.print();
+        // stdout only carries the responses
+        error::DiagnosticEngine to_stderr(std::cerr);
+        serve(std::cin, std::cout);
+        return 0;
     }
-    std::cout << '\n';
-#endif
-
-    Parser parser(tokens);
-    auto statements = parser.parse();
-
-#if DEBUG_AST
-    Printer printer;
-    printer.print(statements);
-    std::cout << "\n\n";
-#endif
 
-    Analyzer analyzer;
-    analyzer.analyze(statements);
+    if (path == nullptr)
+    {
+        error::fatal("No input files");
+    }
 
-    IRGenerator generator;
-    auto ir = generator.generate(statements);
-    for (auto const &func : ir.second)
+    common::SourceBuffer source(path);
+    cminus::Output output;
+    bool compiled;
+    if (options.pipelined)
     {
-        for (auto const &instr : func.second.body)
+        // the assembly goes straight to the file as it is generated
+        std::FILE *file = std::fopen("test.asm", "wb");
+        if (file == nullptr)
+        {
+            error::fatal("Failed to open test.asm");
+        }
+        {
+            common::Writer assembly(file);
+            compiled =
+                cminus::compile(source.text(), options, assembly, output);
+        }
+        std::fclose(file);
+        if (!compiled)
         {
-            std ::cout << instr->to_string() << '\n';
+            std::remove("test.asm");
         }
-         std::cout << '\n';
     }
-    for (auto const &instr : ir.first)
+    else
     {
-        std ::cout << instr->to_string() << '\n';
+        compiled = cminus::compile(source.text(), options, output);
+        if (compiled)
+        {
+            common::write_file("test.asm", output.assembly);
+        }
     }
-    std::cout << "\n\n";
 
-    std::string asm_code = generate_assembly(ir);
-
-    common::write_file("test.asm", asm_code);
+    std::fwrite(output.dump.data(), 1, output.dump.size(), stdout);
+    if (compiled && emit_asm)
+    {
+        if (options.pipelined)
+        {
+            common::SourceBuffer assembly("test.asm");
+            output.assembly = assembly.text();
+        }
+        std::fwrite(
+            output.assembly.data(), 1, output.assembly.size(), stdout
+        );
+    }
+    std::fwrite(
+        output.diagnostics.data(), 1, output.diagnostics.size(), stdout
+    );
 }
 catch (error::Fatal const &error)
 {
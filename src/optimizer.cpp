@@ -0,0 +1,247 @@
+#include "optimizer.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "cfg.hpp"
+#include "common/interner.hpp"
+#include "common/irinstructions.hpp"
+#include "dce.hpp"
+#include "gvn.hpp"
+#include "licm.hpp"
+#include "sccp.hpp"
+#include "ssa.hpp"
+
+namespace
+{
+// Per function of `ir`, whether it may be called while it runs: when it is
+// on a cycle of calls, or calls a function defined elsewhere, directly or
+// not, which might call it back.
+std::vector<bool> find_reentrant(IRProgram const &ir)
+{
+    uint32_t count = static_cast<uint32_t>(ir.functions.size());
+    std::unordered_map<common::Symbol, uint32_t> index;
+    for (uint32_t ix = 0; ix < count; ++ix)
+    {
+        index[ir.functions[ix].name] = ix;
+    }
+
+    std::vector<std::vector<uint32_t>> callees(count);
+    std::vector<bool> calls_out(count);
+    for (uint32_t ix = 0; ix < count; ++ix)
+    {
+        for (IRInstr const &instr : ir.functions[ix].code)
+        {
+            if (instr.kind != IRType::Call)
+            {
+                continue;
+            }
+            auto it = index.find(instr.variant.call.func.id);
+            if (it == index.end())
+            {
+                calls_out[ix] = true;
+            }
+            else
+            {
+                callees[ix].push_back(it->second);
+            }
+        }
+    }
+
+    // Tarjan's algorithm without recursion. It completes the components of
+    // the callees before those of their callers, so whether a callee ends
+    // up calling out is known by then.
+    constexpr uint32_t unvisited = UINT32_MAX;
+    std::vector<uint32_t> order(count, unvisited);
+    std::vector<uint32_t> low(count);
+    std::vector<uint32_t> component(count, unvisited);
+    std::vector<bool> reaches_out(count);
+    std::vector<bool> reentrant(count);
+    std::vector<uint32_t> stack;
+    uint32_t clock = 0;
+
+    struct Frame
+    {
+        uint32_t func;
+        size_t callee;
+    };
+    std::vector<Frame> frames;
+    auto visit = [&](uint32_t func)
+    {
+        order[func] = low[func] = clock++;
+        stack.push_back(func);
+        frames.push_back({func, 0});
+    };
+    for (uint32_t root = 0; root < count; ++root)
+    {
+        if (order[root] != unvisited)
+        {
+            continue;
+        }
+        visit(root);
+        while (!frames.empty())
+        {
+            Frame &frame = frames.back();
+            uint32_t func = frame.func;
+            if (frame.callee < callees[func].size())
+            {
+                uint32_t callee = callees[func][frame.callee++];
+                if (order[callee] == unvisited)
+                {
+                    visit(callee);
+                }
+                else if (component[callee] == unvisited)
+                {
+                    // still on the stack
+                    low[func] = std::min(low[func], order[callee]);
+                }
+                continue;
+            }
+            frames.pop_back();
+            if (!frames.empty())
+            {
+                uint32_t caller = frames.back().func;
+                low[caller] = std::min(low[caller], low[func]);
+            }
+            if (low[func] != order[func])
+            {
+                continue;
+            }
+
+            std::vector<uint32_t> members;
+            do
+            {
+                members.push_back(stack.back());
+                component[stack.back()] = func;
+                stack.pop_back();
+            } while (members.back() != func);
+
+            bool cycle =
+                members.size() > 1 ||
+                std::find(callees[func].begin(), callees[func].end(), func) !=
+                    callees[func].end();
+            bool out = false;
+            for (uint32_t member : members)
+            {
+                out = out || calls_out[member];
+                for (uint32_t callee : callees[member])
+                {
+                    out = out || (component[callee] != func &&
+                                  reaches_out[callee]);
+                }
+            }
+            for (uint32_t member : members)
+            {
+                reaches_out[member] = out;
+                reentrant[member] = cycle || out;
+            }
+        }
+    }
+    return reentrant;
+}
+
+// Optimizes a function that may be re-entered only where its control
+// flow goes, as any call may change the values of its temporaries.
+void simplify_function(
+    IRFunction &func, IRContext &context, OptimizerStats &stats
+)
+{
+    stats.instructions_before += func.code.size();
+    CFG cfg(func, context);
+    stats.dead += simplify_control_flow(cfg);
+    cfg.linearize();
+    stats.instructions_after += func.code.size();
+}
+
+void optimize_function(
+    IRFunction &func, IRContext &context,
+    std::span<common::Symbol const> promoted, OptimizerStats &stats
+)
+{
+    stats.instructions_before += func.code.size();
+    CFG cfg(func, context);
+    construct_ssa(cfg, context, promoted);
+    propagate_constants(cfg, context);
+    stats.redundant += number_values(cfg, promoted);
+    stats.hoisted += hoist_loop_invariants(cfg, promoted);
+    stats.dead += remove_dead_code(cfg);
+    destruct_ssa(cfg, context);
+    // the copies left in blocks may have been coalesced away
+    stats.dead += remove_empty_blocks(cfg);
+    cfg.linearize();
+    stats.instructions_after += func.code.size();
+}
+}  // namespace
+
+void optimize(
+    IRProgram &ir, IRContext &context, bool whole_program,
+    OptimizerStats &stats
+)
+{
+    uint32_t count = static_cast<uint32_t>(ir.functions.size());
+    auto function = [&](uint32_t ix) -> IRFunction &
+    { return ix == count ? ir.main : ir.functions[ix]; };
+
+    // the one function using each variable, the top-level code numbered
+    // last
+    constexpr uint32_t shared = UINT32_MAX;
+    std::unordered_map<common::Symbol, uint32_t> owner;
+    for (uint32_t ix = 0; ix <= count; ++ix)
+    {
+        auto claim = [&](Operand &operand)
+        {
+            if (operand.kind != OperandKind::Var)
+            {
+                return;
+            }
+            auto [it, added] = owner.try_emplace(operand.id, ix);
+            if (!added && it->second != ix)
+            {
+                it->second = shared;
+            }
+        };
+        IRFunction &func = function(ix);
+        for (Operand &param : func.params)
+        {
+            claim(param);
+        }
+        for (IRInstr &instr : func.code)
+        {
+            func.for_each_use(instr, claim);
+            if (Operand *dst = instr.dst())
+            {
+                claim(*dst);
+            }
+        }
+    }
+
+    std::vector<bool> reentrant = find_reentrant(ir);
+    for (uint32_t ix = 0; ix <= count; ++ix)
+    {
+        if (ix < count && reentrant[ix])
+        {
+            simplify_function(function(ix), context, stats);
+            continue;
+        }
+        IRFunction &func = function(ix);
+        std::vector<common::Symbol> promoted;
+        auto promote = [&](Operand var)
+        {
+            auto it = owner.find(var.id);
+            if (it != owner.end() && it->second == ix)
+            {
+                promoted.push_back(var.id);
+            }
+        };
+        if (ix < count || whole_program)
+        {
+            std::for_each(func.params.begin(), func.params.end(), promote);
+            std::for_each(func.locals.begin(), func.locals.end(), promote);
+        }
+        optimize_function(func, context, promoted, stats);
+    }
+}
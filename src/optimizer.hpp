@@ -0,0 +1,41 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include <cstddef>
+
+#include "common/irinstructions.hpp"
+#include "irgenerator.hpp"
+
+// What the optimizer did, summed over the calls of optimize().
+struct OptimizerStats
+{
+    size_t instructions_before = 0;
+    size_t instructions_after = 0;
+    // removed as dead code, see dce.hpp
+    size_t dead = 0;
+    // removed as redundant, see gvn.hpp
+    size_t redundant = 0;
+    // moved out of loops, see licm.hpp
+    size_t hoisted = 0;
+};
+
+// Optimizes the code of `ir` in place, through SSA form, where constants
+// are propagated and folded along with the branches on them, redundant
+// computations and dead code are removed, and what does not change in a
+// loop is moved out of it. Adds what it did to `stats`.
+// `whole_program` says `ir` holds all of the program, else it is one
+// declaration in pipelined mode, whose top-level variables later ones may
+// still use.
+//
+// Parameters and local variables are promoted out of memory unless nested
+// functions use them too, and so are top-level variables no function uses,
+// if `ir` holds the whole program. As all storage is static, a function
+// must also not be running twice at once for that, so functions that may
+// be called while they run, directly or through a function defined
+// elsewhere, only lose their unreachable and empty blocks.
+void optimize(
+    IRProgram &ir, IRContext &context, bool whole_program,
+    OptimizerStats &stats
+);
+
+#endif
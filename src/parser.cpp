@@ -1,34 +1,55 @@
 #include "parser.hpp"
 
-#include <memory>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "common/ast.hpp"
 #include "common/expression.hpp"
 #include "common/error.hpp"
 #include "common/statements.hpp"
 #include "common/token.hpp"
+#include "lexer.hpp"
 
-Parser::Parser(std::vector<Token> tokens)
-    : m_had_error(false),
+// Number of tokens requested from the lexer at once in streaming mode.
+static constexpr size_t chunk_size = 4096;
+
+Parser::Parser(std::vector<Token> tokens, std::string_view source)
+    : m_ast(source),
+      m_had_error(false),
+      m_panic(false),
+      m_lexer(nullptr),
       m_tokens(std::move(tokens)),
-      m_current(0),
-      m_scope_depth(0)
+      m_current(0)
+{
+}
+
+Parser::Parser(Lexer &lexer, std::string_view source)
+    : m_ast(source),
+      m_had_error(false),
+      m_panic(false),
+      m_lexer(&lexer),
+      m_tokens({}),
+      m_current(0)
 {
+    m_tokens.reserve(2 * chunk_size);
+    fill();
 }
 
 Parser::~Parser() {}
 
-std::vector<std::unique_ptr<Stmt>> Parser::parse()
+Ast Parser::parse()
 {
-    std::vector<std::unique_ptr<Stmt>> statements;
-    while (!is_at_end())
+    while (!is_at_end() && !error::limit_reached())
     {
         auto stmt = parse_decl();
-        if (stmt)
+        if (!stmt.is_none())
         {
-            statements.push_back(std::move(stmt));
+            m_ast.statements.push_back(stmt);
         }
     }
 
@@ -36,80 +57,141 @@ std::vector<std::unique_ptr<Stmt>> Parser::parse()
     {
         error::fatal("Encountered an error during parsing pass");
     }
-    return statements;
+    return std::move(m_ast);
 }
 
-std::unique_ptr<Stmt> Parser::parse_decl()
-try
+bool Parser::parse_next()
 {
-    if (match({TokenType::Fn}))
+    m_ast.clear();
+    if (is_at_end() || error::limit_reached())
     {
-        return parse_func_decl();
+        if (m_had_error)
+        {
+            error::fatal("Encountered an error during parsing pass");
+        }
+        return false;
     }
-    if (match({TokenType::Let}))
+
+    auto stmt = parse_decl();
+    if (!stmt.is_none())
     {
-        return parse_var_decl();
+        m_ast.statements.push_back(stmt);
     }
-
-    return parse_stmt();
+    return true;
 }
-catch (error::Synchronize const &err)
+
+StmtRef Parser::parse_decl()
 {
-    m_had_error = true;
-    synchronize();
-    return nullptr;
+    StmtRef stmt;
+    if (match({TokenType::Fn}))
+    {
+        stmt = parse_func_decl();
+    }
+    else if (match({TokenType::Let}))
+    {
+        stmt = parse_var_decl();
+    }
+    else
+    {
+        stmt = parse_stmt();
+    }
+
+    if (m_panic)
+    {
+        // declarations never nest inside expressions, so whatever is left on
+        // the stacks belongs to the expression that failed
+        m_operands.clear();
+        m_operators.clear();
+        m_arguments.clear();
+        synchronize();
+        return {};
+    }
+    return stmt;
 }
 
-std::unique_ptr<Stmt> Parser::parse_func_decl()
+StmtRef Parser::parse_func_decl()
 {
-    Token name = consume(TokenType::Identifier, "Expected function name.");
+    if (!consume(TokenType::Identifier, "Expected function name."))
+    {
+        return {};
+    }
+    Token name = previous();
 
-    consume(TokenType::LeftParen, "Expect '(' after function name.");
-    std::vector<Token> parameters = {};
+    if (!consume(TokenType::LeftParen, "Expect '(' after function name."))
+    {
+        return {};
+    }
+    m_parameters.clear();
     if (!check(TokenType::RightParen))
     {
         do
         {
-            if (parameters.size() >= 255)
+            if (m_parameters.size() >= 255)
             {
-                error::Synchronize(
-                    peek().line, "Can't have more than 255 parameters."
+                // reported, but the parameters can still be parsed
+                m_had_error = true;
+                error::report(
+                    peek().offset, "Can't have more than 255 parameters."
                 );
             }
 
-            parameters.push_back(
-                consume(TokenType::Identifier, "Expect parameter name.")
-            );
+            if (!consume(TokenType::Identifier, "Expect parameter name."))
+            {
+                return {};
+            }
+            m_parameters.push_back(m_ast.add_token(previous()));
         } while (match({TokenType::Comma}));
     }
-    consume(TokenType::RightParen, "Expect ')' after parameters.");
-
-    consume(TokenType::LeftBrace, "Expect '{' before function body.");
+    if (!consume(TokenType::RightParen, "Expect ')' after parameters.") ||
+        !consume(TokenType::LeftBrace, "Expect '{' before function body."))
+    {
+        return {};
+    }
+    uint32_t first_param = m_ast.add_list(m_parameters);
+    auto param_count = static_cast<uint32_t>(m_parameters.size());
 
     auto body = parse_block_stmt();
+    if (m_panic)
+    {
+        return {};
+    }
 
-    return std::make_unique<Stmt>(name.line, FuncStmt(std::move(name), std::move(parameters), std::move(body)));
+    return m_ast.add(
+        FuncStmt{m_ast.add_token(name), first_param, param_count, body}
+    );
 }
 
-std::unique_ptr<Stmt> Parser::parse_var_decl()
+StmtRef Parser::parse_var_decl()
 {
-    Token token = consume(TokenType::Identifier, "Expect variable name.");
+    if (!consume(TokenType::Identifier, "Expect variable name."))
+    {
+        return {};
+    }
+    Token token = previous();
 
-    std::unique_ptr<Expr> initializer;
+    ExprRef initializer;
     if (match({TokenType::Equal}))
     {
         initializer = parse_expr();
+        if (m_panic)
+        {
+            return {};
+        }
     }
 
-    consume(TokenType::SemiColon, "Expect ';' after variable declaration.");
+    if (!consume(
+            TokenType::SemiColon, "Expect ';' after variable declaration."
+        ))
+    {
+        return {};
+    }
 
-    return std::make_unique<Stmt>(
-        previous().line,
-        VarStmt(LocalVar(token, m_scope_depth), std::move(initializer))
+    return m_ast.add(
+        VarStmt{LocalVar{m_ast.add_token(token), {}}, initializer}
     );
 }
 
-std::unique_ptr<Stmt> Parser::parse_stmt()
+StmtRef Parser::parse_stmt()
 {
     if (match({TokenType::Print}))
     {
@@ -135,364 +217,409 @@ std::unique_ptr<Stmt> Parser::parse_stmt()
     return parse_expr_stmt();
 }
 
-std::unique_ptr<Stmt> Parser::parse_print_stmt()
+StmtRef Parser::parse_print_stmt()
 {
     auto value = parse_expr();
-    consume(TokenType::SemiColon, "Expect ';' after value.");
-    return std::make_unique<Stmt>(previous().line, PrintStmt(std::move(value)));
+    if (m_panic || !consume(TokenType::SemiColon, "Expect ';' after value."))
+    {
+        return {};
+    }
+    return m_ast.add(PrintStmt{value});
 }
 
-std::unique_ptr<Stmt> Parser::parse_block_stmt()
+StmtRef Parser::parse_block_stmt()
 {
-    // begin scope
-    m_scope_depth++;
-
-    std::vector<std::unique_ptr<Stmt>> statements = {};
-    while (!check(TokenType::RightBrace) && !is_at_end())
+    // nested blocks use the stack above these statements
+    size_t base = m_statements.size();
+    while (!check(TokenType::RightBrace) && !is_at_end() &&
+           !error::limit_reached())
     {
-        statements.push_back(parse_decl());
+        m_statements.push_back(parse_decl());
+    }
+    std::span<StmtRef const> statements =
+        std::span(m_statements).subspan(base);
+    uint32_t first = m_ast.add_list(statements);
+    auto count = static_cast<uint32_t>(statements.size());
+    m_statements.resize(base);
+    if (!consume(TokenType::RightBrace, "Expect '}' after block."))
+    {
+        return {};
     }
-    consume(TokenType::RightBrace, "Expect '}' after block.");
-
-    // end scope
-    m_scope_depth--;
 
-    return std::make_unique<Stmt>(
-        previous().line, BlockStmt(std::move(statements))
-    );
+    return m_ast.add(BlockStmt{first, count});
 }
 
-std::unique_ptr<Stmt> Parser::parse_expr_stmt()
+StmtRef Parser::parse_expr_stmt()
 {
     auto expr = parse_expr();
-    consume(TokenType::SemiColon, "Expect ';' after expression.");
-    return std::make_unique<Stmt>(previous().line, ExprStmt(std::move(expr)));
+    if (m_panic ||
+        !consume(TokenType::SemiColon, "Expect ';' after expression."))
+    {
+        return {};
+    }
+    return m_ast.add(ExprStmt{expr});
 }
 
-std::unique_ptr<Stmt> Parser::parse_if_stmt()
+StmtRef Parser::parse_if_stmt()
 {
-    consume(TokenType::LeftParen, "Expect '(' after 'if'");
+    if (!consume(TokenType::LeftParen, "Expect '(' after 'if'"))
+    {
+        return {};
+    }
     auto condition = parse_expr();
-    consume(TokenType::RightParen, "Expect ')' after if condition");
+    if (m_panic ||
+        !consume(TokenType::RightParen, "Expect ')' after if condition"))
+    {
+        return {};
+    }
 
     auto thenBranch = parse_stmt();
-    std::unique_ptr<Stmt> elseBranch = nullptr;
+    if (m_panic)
+    {
+        return {};
+    }
+    StmtRef elseBranch;
     if (match({TokenType::Else}))
     {
         elseBranch = parse_stmt();
+        if (m_panic)
+        {
+            return {};
+        }
     }
 
-    return std::make_unique<Stmt>(
-        previous().line,
-        IfStmt(
-            std::move(condition), std::move(thenBranch), std::move(elseBranch)
-        )
-    );
+    return m_ast.add(IfStmt{condition, thenBranch, elseBranch});
 }
 
-std::unique_ptr<Stmt> Parser::parse_while_stmt()
+StmtRef Parser::parse_while_stmt()
 {
-    consume(TokenType::LeftParen, "Expect '(' after 'while'.");
+    if (!consume(TokenType::LeftParen, "Expect '(' after 'while'."))
+    {
+        return {};
+    }
     auto condition = parse_expr();
-    consume(TokenType::RightParen, "Expect ')' after condition.");
+    if (m_panic ||
+        !consume(TokenType::RightParen, "Expect ')' after condition."))
+    {
+        return {};
+    }
     auto body = parse_stmt();
+    if (m_panic)
+    {
+        return {};
+    }
 
-    return std::make_unique<Stmt>(
-        previous().line, WhileStmt(std::move(condition), std::move(body))
-    );
+    return m_ast.add(WhileStmt{condition, body});
 }
 
-std::unique_ptr<Stmt> Parser::parse_for_stmt()
+StmtRef Parser::parse_for_stmt()
 {
-    consume(TokenType::LeftParen, "Expect '(' after 'for'.");
+    if (!consume(TokenType::LeftParen, "Expect '(' after 'for'."))
+    {
+        return {};
+    }
 
-    std::unique_ptr<Stmt> initializer = nullptr;
+    StmtRef initializer;
     if (match({TokenType::SemiColon}))
     {
-        initializer = nullptr;
+        initializer = {};
     }
     else if (match({TokenType::Let}))
     {
         initializer = parse_var_decl();
-        initializer->variant.var.var.scope_depth += 1;
     }
     else
     {
         initializer = parse_expr_stmt();
     }
+    if (m_panic)
+    {
+        return {};
+    }
 
-    std::unique_ptr<Expr> condition = nullptr;
+    ExprRef condition;
     if (!check(TokenType::SemiColon))
     {
         condition = parse_expr();
     }
-    consume(TokenType::SemiColon, "Expect ';' after loop condition.");
+    if (m_panic ||
+        !consume(TokenType::SemiColon, "Expect ';' after loop condition."))
+    {
+        return {};
+    }
 
-    std::unique_ptr<Expr> increment = nullptr;
+    ExprRef increment;
     if (!check(TokenType::RightParen))
     {
         increment = parse_expr();
     }
-    consume(TokenType::RightParen, "Expect ')' after for clauses.");
-
-    std::unique_ptr<Stmt> body = parse_stmt();
-
-    if (increment != nullptr)
+    if (m_panic ||
+        !consume(TokenType::RightParen, "Expect ')' after for clauses."))
     {
-        auto incr_stmt = std::make_unique<Stmt>(
-            previous().line, ExprStmt(std::move(increment))
-        );
-        body->variant.block.statements.push_back(std::move(incr_stmt));
+        return {};
     }
 
-    if (condition == nullptr)
+    StmtRef body = parse_stmt();
+    if (m_panic)
     {
-        condition = std::make_unique<Expr>(
-            condition->line,
-            LiteralExpr(
-                Token(TokenType::True, "true", Literal(1), condition->line, 0)
-            )
-        );
+        return {};
     }
 
-    body = std::make_unique<Stmt>(
-        previous().line, WhileStmt(std::move(condition), std::move(body))
-    );
+    if (!increment.is_none())
+    {
+        // run the increment after the body, outside of the body's scope
+        std::array<StmtRef, 2> with_increment = {
+            body, m_ast.add(ExprStmt{increment})
+        };
+        body = m_ast.add(BlockStmt{m_ast.add_list(with_increment), 2});
+    }
 
-    if (initializer != nullptr)
+    if (condition.is_none())
     {
-        std::vector<std::unique_ptr<Stmt>> for_stmt = {};
+        condition = m_ast.add(LiteralExpr{1});
+    }
 
-        for_stmt.push_back(std::move(initializer));
-        for_stmt.push_back(std::move(body));
+    body = m_ast.add(WhileStmt{condition, body});
 
-        body = std::make_unique<Stmt>(
-            previous().line, BlockStmt(std::move(for_stmt))
-        );
+    if (!initializer.is_none())
+    {
+        std::array<StmtRef, 2> for_stmt = {initializer, body};
+        body = m_ast.add(BlockStmt{m_ast.add_list(for_stmt), 2});
     }
 
     return body;
 }
 
-std::unique_ptr<Expr> Parser::parse_expr() { return parse_assignment(); }
-
-std::unique_ptr<Expr> Parser::parse_assignment()
+// Binding power of each operator token, 0 for tokens that cannot continue
+// an expression. Prefix operators all bind with `unary_precedence`.
+static constexpr uint8_t unary_precedence = 8;
+static constexpr auto precedence = []
+{
+    std::array<uint8_t, 64> table = {};
+    table[static_cast<uint8_t>(TokenType::Equal)] = 1;
+    table[static_cast<uint8_t>(TokenType::BoolOr)] = 2;
+    table[static_cast<uint8_t>(TokenType::BoolAnd)] = 3;
+    table[static_cast<uint8_t>(TokenType::BangEqual)] = 4;
+    table[static_cast<uint8_t>(TokenType::EqualEqual)] = 4;
+    table[static_cast<uint8_t>(TokenType::Greater)] = 5;
+    table[static_cast<uint8_t>(TokenType::GreaterEqual)] = 5;
+    table[static_cast<uint8_t>(TokenType::Less)] = 5;
+    table[static_cast<uint8_t>(TokenType::LessEqual)] = 5;
+    table[static_cast<uint8_t>(TokenType::Plus)] = 6;
+    table[static_cast<uint8_t>(TokenType::Minus)] = 6;
+    table[static_cast<uint8_t>(TokenType::Slash)] = 7;
+    table[static_cast<uint8_t>(TokenType::Star)] = 7;
+    return table;
+}();
+
+// Operator precedence parsing with explicit operand and operator stacks.
+// Prefix operators and opening parentheses are pushed as they are read,
+// every binary operator first reduces the pending operators that bind at
+// least as tight (assignment, being right associative, only those that
+// bind tighter). Parsing is linear in the number of tokens, and nesting
+// only grows the stacks, never the call stack; the one exception are call
+// arguments, which are parsed as expressions of their own.
+ExprRef Parser::parse_expr()
 {
-    auto expr = parse_or();
+    size_t operand_base = m_operands.size();
+    size_t operator_base = m_operators.size();
+    size_t open_groups = 0;
 
-    if (match({TokenType::Equal}))
+    while (true)
     {
-        Token equals = previous();
-        auto value = parse_assignment();
-
-        if (expr->kind == ExprType::Var)
+        while (true)
         {
-            VarExpr &var_expr = expr->variant.var;
-            Token name = var_expr.var.token;
-            return std::make_unique<Expr>(
-                name.line,
-                AssignExpr(LocalVar(name, m_scope_depth), std::move(value))
-            );
+            if (match({TokenType::Bang, TokenType::Minus}))
+            {
+                m_operators.push_back(
+                    {previous().kind, unary_precedence, previous().offset}
+                );
+            }
+            else if (match({TokenType::LeftParen}))
+            {
+                m_operators.push_back({TokenType::LeftParen, 0, 0});
+                open_groups++;
+            }
+            else
+            {
+                break;
+            }
         }
 
-        error::synchronize(previous().line, "Invalid assignment target.");
-    }
-
-    return expr;
-}
-
-std::unique_ptr<Expr> Parser::parse_or()
-{
-    auto left = parse_and();
+        ExprRef operand = parse_primary();
+        if (m_panic)
+        {
+            return {};
+        }
+        m_operands.push_back(parse_func_call(operand));
+        if (m_panic)
+        {
+            return {};
+        }
 
-    while (match({TokenType::BoolOr}))
-    {
-        Token op = previous();
-        auto right = parse_and();
-        auto expr = std::make_unique<Expr>(
-            op.line,
-            BinaryExpr(std::move(left), std::move(op), std::move(right))
-        );
-        return expr;
-    }
+        // close the groups opened by this expression
+        while (open_groups > 0 && check(TokenType::RightParen))
+        {
+            advance();
+            open_groups--;
+            while (m_operators.back().kind != TokenType::LeftParen)
+            {
+                if (!reduce())
+                {
+                    return {};
+                }
+            }
+            m_operators.pop_back();
+            m_operands.back() = parse_func_call(
+                m_ast.add(GroupingExpr{m_operands.back()})
+            );
+            if (m_panic)
+            {
+                return {};
+            }
+        }
 
-    return left;
-}
+        TokenType kind = peek().kind;
+        uint8_t binding = precedence[static_cast<uint8_t>(kind)];
+        if (binding == 0)
+        {
+            break;
+        }
 
-std::unique_ptr<Expr> Parser::parse_and()
-{
-    auto left = parse_equality();
+        bool right_assoc = kind == TokenType::Equal;
+        while (m_operators.size() > operator_base &&
+               (m_operators.back().precedence > binding ||
+                (m_operators.back().precedence == binding && !right_assoc)))
+        {
+            if (!reduce())
+            {
+                return {};
+            }
+        }
 
-    while (match({TokenType::BoolAnd}))
-    {
-        Token op = previous();
-        auto right = parse_equality();
-        auto expr = std::make_unique<Expr>(
-            op.line,
-            BinaryExpr(std::move(left), std::move(op), std::move(right))
-        );
-        return expr;
+        advance();
+        m_operators.push_back({kind, binding, previous().offset});
     }
 
-    return left;
-}
-
-std::unique_ptr<Expr> Parser::parse_equality()
-{
-    auto expr = parse_comparison();
-
-    while (match({TokenType::BangEqual, TokenType::EqualEqual}))
+    while (m_operators.size() > operator_base)
     {
-        Token op = previous();
-        auto right = parse_comparison();
-        expr = std::make_unique<Expr>(
-            op.line,
-            BinaryExpr(std::move(expr), std::move(op), std::move(right))
-        );
+        if (m_operators.back().kind == TokenType::LeftParen)
+        {
+            fail(previous().offset, "Expect ')' after expression");
+            return {};
+        }
+        if (!reduce())
+        {
+            return {};
+        }
     }
 
+    ExprRef expr = m_operands.back();
+    m_operands.resize(operand_base);
     return expr;
 }
 
-std::unique_ptr<Expr> Parser::parse_comparison()
+bool Parser::reduce()
 {
-    auto expr = parse_term();
-
-    while (match(
-        {TokenType::Greater, TokenType::GreaterEqual, TokenType::Less,
-         TokenType::LessEqual}
-    ))
-    {
-        Token op = previous();
-        auto right = parse_term();
-        expr = std::make_unique<Expr>(
-            op.line,
-            BinaryExpr(std::move(expr), std::move(op), std::move(right))
-        );
-    }
-
-    return expr;
-}
+    Operator op = m_operators.back();
+    m_operators.pop_back();
 
-std::unique_ptr<Expr> Parser::parse_term()
-{
-    auto expr = parse_factor();
+    ExprRef right = m_operands.back();
+    m_operands.pop_back();
 
-    while (match({TokenType::Plus, TokenType::Minus}))
+    if (op.precedence == unary_precedence)
     {
-        Token op = previous();
-        auto right = parse_factor();
-        expr = std::make_unique<Expr>(
-            op.line,
-            BinaryExpr(std::move(expr), std::move(op), std::move(right))
-        );
+        m_operands.push_back(m_ast.add(UnaryExpr{right, op.kind}));
+        return true;
     }
 
-    return expr;
-}
-
-std::unique_ptr<Expr> Parser::parse_factor()
-{
-    auto expr = parse_unary();
-
-    while (match({TokenType::Slash, TokenType::Star}))
+    ExprRef left = m_operands.back();
+    if (op.kind == TokenType::Equal)
     {
-        Token op = previous();
-        auto right = parse_unary();
-        expr = std::make_unique<Expr>(
-            op.line,
-            BinaryExpr(std::move(expr), std::move(op), std::move(right))
-        );
-    }
-
-    return expr;
-}
+        if (left.kind() != ExprType::Var)
+        {
+            fail(op.offset, "Invalid assignment target.");
+            return false;
+        }
 
-std::unique_ptr<Expr> Parser::parse_unary()
-{
-    if (match({TokenType::Bang, TokenType::Minus}))
-    {
-        Token op = previous();
-        auto right = parse_unary();
-        return std::make_unique<Expr>(
-            op.line, UnaryExpr(std::move(op), std::move(right))
-        );
+        TokenRef name = m_ast.get<VarExpr>(left).name;
+        m_operands.back() = m_ast.add(AssignExpr{name, right, {}});
+        return true;
     }
 
-    return parse_func_call();
+    m_operands.back() = m_ast.add(BinaryExpr{left, right, op.kind});
+    return true;
 }
 
-std::unique_ptr<Expr> Parser::parse_func_call()
+ExprRef Parser::parse_func_call(ExprRef expr)
 {
-    auto expr = parse_primary();
-
-    while (true)
+    while (match({TokenType::LeftParen}))
     {
-        if (match({TokenType::LeftParen}))
+        expr = parse_finish_call(expr);
+        if (m_panic)
         {
-            expr = parse_finish_call(std::move(expr));
-        }
-        else
-        {
-            break;
+            return {};
         }
     }
 
     return expr;
 }
 
-std::unique_ptr<Expr> Parser::parse_finish_call(std::unique_ptr<Expr> callee)
+ExprRef Parser::parse_finish_call(ExprRef callee)
 {
-    std::vector<std::unique_ptr<Expr>> arguments = {};
+    // calls in the arguments use the stack above these
+    size_t base = m_arguments.size();
     if (!check(TokenType::RightParen))
     {
         do
         {
-            arguments.push_back(parse_expr());
+            ExprRef argument = parse_expr();
+            if (m_panic)
+            {
+                return {};
+            }
+            m_arguments.push_back(argument);
         } while (match({TokenType::Comma}));
     }
 
-    Token paren = consume(TokenType::RightParen, "Expect ')' after arguments.");
+    if (!consume(TokenType::RightParen, "Expect ')' after arguments."))
+    {
+        return {};
+    }
 
-    return std::make_unique<Expr>(
-        paren.line, CallExpr(std::move(callee), std::move(arguments))
-    );
+    std::span<ExprRef const> arguments = std::span(m_arguments).subspan(base);
+    uint32_t first_arg = m_ast.add_list(arguments);
+    auto arg_count = static_cast<uint32_t>(arguments.size());
+    m_arguments.resize(base);
+    return m_ast.add(CallExpr{callee, first_arg, arg_count});
 }
 
-std::unique_ptr<Expr> Parser::parse_primary()
+ExprRef Parser::parse_primary()
 {
     if (match({TokenType::Number, TokenType::String}))
     {
-        Token token = previous();
-        return std::make_unique<Expr>(
-            token.line, LiteralExpr(std::move(token))
-        );
+        return m_ast.add(LiteralExpr{previous().value});
     }
 
     if (match({TokenType::Identifier}))
     {
-        Token token = previous();
-        return std::make_unique<Expr>(
-            token.line, VarExpr(LocalVar(token, m_scope_depth))
-        );
+        return m_ast.add(VarExpr{m_ast.add_token(previous()), {}});
     }
 
-    if (match({TokenType::LeftParen}))
-    {
-        Token paren = previous();
-        auto expr = parse_expr();
-        consume(TokenType::RightParen, "Expect ')' after expression");
-        return std::make_unique<Expr>(
-            paren.line, GroupingExpr(std::move(expr))
-        );
-    }
+    fail(previous().offset, "Expected expression");
+    return {};
+}
 
-    error::synchronize(previous().line, "Expected expression");
-    return nullptr;
+void Parser::fail(uint32_t offset, char const *message)
+{
+    error::report(offset, message);
+    m_had_error = true;
+    m_panic = true;
 }
 
 void Parser::synchronize()
 {
+    m_panic = false;
     advance();
 
     while (!is_at_end())
@@ -506,15 +633,27 @@ void Parser::synchronize()
     }
 }
 
-bool Parser::match(std::vector<TokenType> types)
+void Parser::fill()
 {
-    for (TokenType type : types)
+    // Only compact once a whole chunk has been consumed, so the cost of
+    // shifting the remaining tokens down stays amortized constant, and the
+    // window never outgrows the two chunks reserved for it.
+    if (m_current > chunk_size)
     {
-        if (check(type))
-        {
-            advance();
-            return true;
-        }
+        // keep the previous token around
+        m_tokens.erase(m_tokens.begin(), m_tokens.begin() + (m_current - 1));
+        m_current = 1;
+    }
+    auto const &chunk = m_lexer->lex_chunk(chunk_size);
+    m_tokens.insert(m_tokens.end(), chunk.begin(), chunk.end());
+}
+
+bool Parser::match(TokenSet types)
+{
+    if (!is_at_end() && types.contains(peek().kind))
+    {
+        advance();
+        return true;
     }
 
     return false;
@@ -529,28 +668,38 @@ bool Parser::check(TokenType type)
     return peek().kind == type;
 }
 
-Token Parser::advance()
+Token const &Parser::advance()
 {
     if (!is_at_end())
     {
         m_current++;
+        if (m_current == m_tokens.size())
+        {
+            fill();
+        }
     }
     return previous();
 }
 
 bool Parser::is_at_end() { return peek().kind == TokenType::Eof; }
 
-Token Parser::peek() { return m_tokens[m_current]; }
+Token const &Parser::peek() { return m_tokens[m_current]; }
 
-Token Parser::previous() { return m_tokens[m_current - 1]; }
+Token const &Parser::previous()
+{
+    // errors are reported at the previous token, or at the first one if it
+    // is already wrong
+    return m_current == 0 ? peek() : m_tokens[m_current - 1];
+}
 
-Token Parser::consume(TokenType type, std::string message)
+bool Parser::consume(TokenType type, char const *message)
 {
     if (check(type))
     {
-        return advance();
+        advance();
+        return true;
     }
 
-    error::synchronize(previous().line, message);
-    return Token();
+    fail(previous().offset, message);
+    return false;
 }
@@ -2,62 +2,97 @@
 #define PARSER_HPP
 
 #include <cstddef>
-#include <memory>
+#include <cstdint>
+#include <string_view>
 #include <vector>
 
+#include "common/ast.hpp"
 #include "common/expression.hpp"
 #include "common/statements.hpp"
 #include "common/token.hpp"
+#include "lexer.hpp"
 
 class Parser
 {
    public:
-    Parser(std::vector<Token> tokens);
+    Parser(std::vector<Token> tokens, std::string_view source);
+    // Streaming mode: tokens are pulled from `lexer` chunk by chunk and
+    // dropped again once parsed, so at most two chunks are held at once.
+    Parser(Lexer &lexer, std::string_view source);
     ~Parser();
 
-    std::vector<std::unique_ptr<Stmt>> parse();
+    Ast parse();
+    // Pipelined mode: replaces the contents of ast() by the next top-level
+    // declaration. Returns false once the input is exhausted, or fails if
+    // any declaration had a syntax error.
+    bool parse_next();
+    Ast &ast() { return m_ast; }
+    bool had_error() const { return m_had_error; }
 
    private:
+    Ast m_ast;
     bool m_had_error;
+    // Set when a syntax error is found. Every parse function then returns
+    // right away, up to the innermost declaration, which skips ahead to the
+    // next statement and clears it again.
+    bool m_panic;
+    Lexer *m_lexer;
     std::vector<Token> m_tokens;
     size_t m_current;
-    size_t m_scope_depth;
+
+    // An operator waiting for its right operand in parse_expr(). Opening
+    // parentheses are kept as LeftParen with precedence 0.
+    struct Operator
+    {
+        TokenType kind;
+        uint8_t precedence;
+        uint32_t offset;
+    };
+
+    // shared by nested parse_expr() calls, which only use the part of the
+    // stacks above what was there when they started
+    std::vector<ExprRef> m_operands;
+    std::vector<Operator> m_operators;
+    // the same for the arguments of calls and the statements of blocks,
+    // which are copied into the tree once complete
+    std::vector<ExprRef> m_arguments;
+    std::vector<StmtRef> m_statements;
+    // functions only nest in the body, after their parameters are copied
+    std::vector<TokenRef> m_parameters;
 
    private:
-    std::unique_ptr<Stmt> parse_decl();
-    std::unique_ptr<Stmt> parse_func_decl();
-    std::unique_ptr<Stmt> parse_var_decl();
-
-    std::unique_ptr<Stmt> parse_stmt();
-    std::unique_ptr<Stmt> parse_print_stmt();
-    std::unique_ptr<Stmt> parse_block_stmt();
-    std::unique_ptr<Stmt> parse_expr_stmt();
-    std::unique_ptr<Stmt> parse_if_stmt();
-    std::unique_ptr<Stmt> parse_while_stmt();
-    std::unique_ptr<Stmt> parse_for_stmt();
-
-    std::unique_ptr<Expr> parse_expr();
-    std::unique_ptr<Expr> parse_assignment();
-    std::unique_ptr<Expr> parse_or();
-    std::unique_ptr<Expr> parse_and();
-    std::unique_ptr<Expr> parse_equality();
-    std::unique_ptr<Expr> parse_comparison();
-    std::unique_ptr<Expr> parse_term();
-    std::unique_ptr<Expr> parse_factor();
-    std::unique_ptr<Expr> parse_unary();
-    std::unique_ptr<Expr> parse_func_call();
-    std::unique_ptr<Expr> parse_finish_call(std::unique_ptr<Expr> callee);
-    std::unique_ptr<Expr> parse_primary();
+    StmtRef parse_decl();
+    StmtRef parse_func_decl();
+    StmtRef parse_var_decl();
+
+    StmtRef parse_stmt();
+    StmtRef parse_print_stmt();
+    StmtRef parse_block_stmt();
+    StmtRef parse_expr_stmt();
+    StmtRef parse_if_stmt();
+    StmtRef parse_while_stmt();
+    StmtRef parse_for_stmt();
+
+    ExprRef parse_expr();
+    ExprRef parse_func_call(ExprRef expr);
+    ExprRef parse_finish_call(ExprRef callee);
+    ExprRef parse_primary();
+    bool reduce();
 
+    void fail(uint32_t offset, char const *message);
     void synchronize();
+    void fill();
 
-    bool match(std::vector<TokenType> types);
+    // Returned references stay valid until the next call to advance(), as
+    // the token window is refilled in streaming mode.
+    bool match(TokenSet types);
     bool check(TokenType type);
-    Token advance();
+    Token const &advance();
     bool is_at_end();
-    Token peek();
-    Token previous();
-    Token consume(TokenType type, std::string message);
+    Token const &peek();
+    Token const &previous();
+    // Reports `message` and fails if the next token is not of `type`.
+    bool consume(TokenType type, char const *message);
 };
 
 #endif
@@ -1,122 +1,146 @@
 #include "printer.hpp"
 
-#include <iostream>
-#include <sstream>
-
-#include "common/error.hpp"
+#include "common/ast.hpp"
 #include "common/statements.hpp"
 #include "common/expression.hpp"
+#include "common/traversal.hpp"
 
-void Printer::print(std::vector<std::unique_ptr<Stmt>> const &statements)
+void Printer::print()
 {
-    for (auto const &stmt : statements)
+    for (StmtRef stmt : m_ast.statements)
     {
-        std::cout << print_stmt(*stmt);
+        walk(m_ast, stmt, *this);
     }
 }
 
-std::string indent(int level) { return std::string(level * 4, ' '); }
+void Printer::pad() { m_out.fill(m_indent_level * 4, ' '); }
 
-std::string Printer::print_expr(Expr const &expr)
+void Printer::enter(BinaryExpr const &expr, ExprRef)
 {
-    std::ostringstream oss;
+    m_out << '(';
+    m_out << TT_to_lexeme(expr.op);
+    m_out << ' ';
+}
 
-    switch (expr.kind)
+void Printer::after(BinaryExpr const &, ExprRef, uint32_t ix)
+{
+    if (ix == 0)
     {
-    case ExprType::Binary:
-        oss << "(" << expr.variant.binary.op.lexeme << " "
-            << print_expr(*expr.variant.binary.left) << " "
-            << print_expr(*expr.variant.binary.right) << ")";
-        break;
-    case ExprType::Literal:
-        oss << expr.variant.literal.token.lexeme;
-        break;
-    case ExprType::Var:
-        oss << expr.variant.var.var.token.lexeme;
-        break;
-    case ExprType::Assign:
-        oss << "(= " << expr.variant.assign.var.token.lexeme << " "
-            << print_expr(*expr.variant.assign.expr) << ")";
-        break;
-    case ExprType::Unary:
-        oss << "(" << expr.variant.unary.op.lexeme << " "
-            << print_expr(*expr.variant.unary.expr) << ")";
-        break;
-    case ExprType::Grouping:
-        oss << "(group " << print_expr(*expr.variant.grouping.expr) << ")";
-        break;
-    case ExprType::Call:
-        oss << expr.variant.call.callee->variant.var.var.token.lexeme << "(";
-        // for (auto const &param : expr.variant.call.args)
-        // {
-        //     oss << param->variant.literal.token.lexeme << " ";
-        // }
-        oss << ")";
-        break;
-    default:
-        error::unreachable();
-        break;
+        m_out << ' ';
     }
+}
 
-    return oss.str();
+void Printer::enter(LiteralExpr const &expr, ExprRef)
+{
+    m_out << expr.value;
 }
 
-std::string Printer::print_stmt(Stmt const &stmt, int indent_level)
+void Printer::enter(VarExpr const &expr, ExprRef)
 {
-    std::ostringstream oss;
-    std::string pad = indent(indent_level);
+    m_out << m_ast.lexeme(expr.name);
+}
+
+void Printer::enter(AssignExpr const &expr, ExprRef)
+{
+    m_out << "(= ";
+    m_out << m_ast.lexeme(expr.name);
+    m_out << ' ';
+}
+
+void Printer::enter(UnaryExpr const &expr, ExprRef)
+{
+    m_out << '(';
+    m_out << TT_to_lexeme(expr.op);
+    m_out << ' ';
+}
+
+void Printer::enter(GroupingExpr const &, ExprRef) { m_out << "(group "; }
+
+bool Printer::enter(CallExpr const &expr, ExprRef)
+{
+    m_out << m_ast.lexeme(m_ast.get<VarExpr>(expr.callee).name);
+    // the arguments are not printed
+    m_out << "()";
+    return false;
+}
+
+void Printer::enter(ExprStmt const &, StmtRef)
+{
+    pad();
+    m_out << "EXPR: ";
+}
+
+void Printer::enter(PrintStmt const &, StmtRef)
+{
+    pad();
+    m_out << "PRINT: ";
+}
+
+void Printer::enter(VarStmt const &stmt, StmtRef)
+{
+    pad();
+    m_out << "VAR DECL: let ";
+    m_out << m_ast.lexeme(stmt.var.token);
+    m_out << " = ";
+}
 
-    switch (stmt.kind)
+void Printer::enter(BlockStmt const &, StmtRef)
+{
+    pad();
+    m_out << "BLOCK {\n";
+    m_indent_level++;
+}
+
+void Printer::leave(BlockStmt const &, StmtRef)
+{
+    m_indent_level--;
+    pad();
+    m_out << "}\n";
+}
+
+void Printer::enter(IfStmt const &, StmtRef)
+{
+    pad();
+    m_out << "IF ";
+}
+
+void Printer::after(IfStmt const &stmt, StmtRef, uint32_t ix)
+{
+    if (ix == 0)
+    {
+        m_out << '\n';
+    }
+    else if (ix == 1 && !stmt.else_branch.is_none())
     {
-    case StmtType::Expr:
-        oss << pad << "EXPR: ";
-        oss << print_expr(*stmt.variant.expr.expr) << '\n';
-        break;
-    case StmtType::Print:
-        oss << pad << "PRINT: ";
-        oss << print_expr(*stmt.variant.print.expr) << '\n';
-        break;
-    case StmtType::Var:
-        oss << pad << "VAR DECL: ";
-        oss << "let " << stmt.variant.var.var.token.lexeme << " = ";
-        oss << print_expr(*stmt.variant.var.expr) << '\n';
-        break;
-    case StmtType::Block:
-        oss << pad << "BLOCK {\n";
-        for (auto &s : stmt.variant.block.statements)
-        {
-            oss << print_stmt(*s, indent_level + 1);
-        }
-        oss << pad << "}\n";
-        break;
-    case StmtType::If:
-        oss << pad << "IF ";
-        oss << print_expr(*stmt.variant.if_.condition) << '\n';
-        oss << print_stmt(*stmt.variant.if_.then_branch, indent_level);
-        if (stmt.variant.if_.else_branch != nullptr)
-        {
-            oss << pad << "ELSE\n";
-            oss << print_stmt(*stmt.variant.if_.else_branch, indent_level);
-        }
-        break;
-    case StmtType::While:
-        oss << pad << "WHILE ";
-        oss << print_expr(*stmt.variant.while_.condition) << '\n';
-        oss << print_stmt(*stmt.variant.while_.body, indent_level);
-        break;
-    case StmtType::Func:
-        oss << pad << "FUNC DECL: " << stmt.variant.func.name.lexeme << "(";
-        for (auto const &param : stmt.variant.func.params)
-        {
-            oss << param.lexeme << " ";
-        }
-        oss << ")\n";
-        oss << print_stmt(*stmt.variant.func.body);
-        break;
-    default:
-        error::unreachable();
-        break;
+        pad();
+        m_out << "ELSE\n";
     }
+}
+
+void Printer::enter(WhileStmt const &, StmtRef)
+{
+    pad();
+    m_out << "WHILE ";
+}
+
+void Printer::after(WhileStmt const &, StmtRef, uint32_t ix)
+{
+    if (ix == 0)
+    {
+        m_out << '\n';
+    }
+}
 
-    return oss.str();
+void Printer::enter(FuncStmt const &stmt, StmtRef)
+{
+    pad();
+    m_out << "FUNC DECL: ";
+    m_out << m_ast.lexeme(stmt.name);
+    m_out << '(';
+    for (TokenRef param : m_ast.params(stmt))
+    {
+        m_out << m_ast.lexeme(param);
+        m_out << ' ';
+    }
+    m_out << ")\n";
 }
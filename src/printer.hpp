@@ -1,23 +1,56 @@
 #ifndef EXPR_PRINTER_HPP
 #define EXPR_PRINTER_HPP
 
-#include <memory>
-#include <string>
-#include <vector>
-
+#include "common/ast.hpp"
 #include "common/expression.hpp"
+#include "common/output.hpp"
 #include "common/statements.hpp"
 
 class Printer
 {
    public:
-    Printer() = default;
+    Printer(Ast const &ast, common::Writer &out)
+        : m_ast(ast), m_indent_level(0), m_out(out)
+    {
+    }
     ~Printer() = default;
 
-    void print(std::vector<std::unique_ptr<Stmt>> const &statements);
+    void print();
+
+    // traversal hooks, see walk()
+    void enter(BinaryExpr const &expr, ExprRef ref);
+    void after(BinaryExpr const &expr, ExprRef ref, uint32_t ix);
+    void enter(LiteralExpr const &expr, ExprRef ref);
+    void enter(VarExpr const &expr, ExprRef ref);
+    void enter(AssignExpr const &expr, ExprRef ref);
+    void enter(UnaryExpr const &expr, ExprRef ref);
+    void enter(GroupingExpr const &expr, ExprRef ref);
+    bool enter(CallExpr const &expr, ExprRef ref);
+    void leave(BinaryExpr const &, ExprRef) { m_out << ')'; }
+    void leave(AssignExpr const &, ExprRef) { m_out << ')'; }
+    void leave(UnaryExpr const &, ExprRef) { m_out << ')'; }
+    void leave(GroupingExpr const &, ExprRef) { m_out << ')'; }
+
+    void enter(ExprStmt const &stmt, StmtRef ref);
+    void enter(PrintStmt const &stmt, StmtRef ref);
+    void enter(VarStmt const &stmt, StmtRef ref);
+    void enter(BlockStmt const &stmt, StmtRef ref);
+    void leave(BlockStmt const &stmt, StmtRef ref);
+    void enter(IfStmt const &stmt, StmtRef ref);
+    void after(IfStmt const &stmt, StmtRef ref, uint32_t ix);
+    void enter(WhileStmt const &stmt, StmtRef ref);
+    void after(WhileStmt const &stmt, StmtRef ref, uint32_t ix);
+    void enter(FuncStmt const &stmt, StmtRef ref);
+    void leave(ExprStmt const &, StmtRef) { m_out << '\n'; }
+    void leave(PrintStmt const &, StmtRef) { m_out << '\n'; }
+    void leave(VarStmt const &, StmtRef) { m_out << '\n'; }
+
+   private:
+    void pad();
 
-    std::string print_expr(Expr const &expr);
-    std::string print_stmt(Stmt const &stmt, int indent_level = 0);
+    Ast const &m_ast;
+    int m_indent_level;
+    common::Writer &m_out;
 };
 
 #endif
@@ -0,0 +1,433 @@
+#include "sccp.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "cfg.hpp"
+#include "common/error.hpp"
+#include "common/interner.hpp"
+#include "common/irinstructions.hpp"
+#include "ssa.hpp"
+
+namespace
+{
+// What is known of a value: nothing while no code defining it has been
+// reached, then one constant, until it turns out to vary.
+struct Lattice
+{
+    enum class State : uint8_t
+    {
+        Unknown,
+        Constant,
+        Varying,
+    };
+
+    State state = State::Unknown;
+    int64_t constant = 0;
+
+    static Lattice of(int64_t value) { return {State::Constant, value}; }
+    static Lattice varying() { return {State::Varying, 0}; }
+
+    bool is_constant() const { return state == State::Constant; }
+    bool operator==(Lattice const &other) const = default;
+
+    // What is known of a value that may be either.
+    Lattice meet(Lattice other) const
+    {
+        if (state == State::Unknown)
+        {
+            return other;
+        }
+        if (other.state == State::Unknown || other == *this)
+        {
+            return *this;
+        }
+        return varying();
+    }
+};
+
+// Applies an operator to constants the way the generated code does, with
+// arithmetic wrapping around at 64 bits and comparisons giving 0 or 1.
+// Unary operators ignore `right`. Returns false for the operators the code
+// generator does not implement, whose results are left to run time.
+bool fold(IROp op, int64_t left, int64_t right, int64_t &result)
+{
+    // unsigned, as signed overflow is undefined
+    uint64_t l = static_cast<uint64_t>(left);
+    uint64_t r = static_cast<uint64_t>(right);
+    switch (op)
+    {
+    case IROp::Add:
+        result = static_cast<int64_t>(l + r);
+        return true;
+    case IROp::Sub:
+        result = static_cast<int64_t>(l - r);
+        return true;
+    case IROp::Mul:
+        result = static_cast<int64_t>(l * r);
+        return true;
+    case IROp::Neg:
+        result = static_cast<int64_t>(0 - l);
+        return true;
+    case IROp::Equal:
+        result = left == right;
+        return true;
+    case IROp::NotEqual:
+        result = left != right;
+        return true;
+    case IROp::Less:
+        result = left < right;
+        return true;
+    case IROp::LessEqual:
+        result = left <= right;
+        return true;
+    case IROp::Greater:
+        result = left > right;
+        return true;
+    case IROp::GreaterEqual:
+        result = left >= right;
+        return true;
+    case IROp::Div:
+    case IROp::And:
+    case IROp::Or:
+    case IROp::Not:
+        return false;
+    }
+
+    error::unreachable();
+    return false;
+}
+
+// Where a value is read.
+struct Site
+{
+    uint32_t block;
+    uint32_t ix;
+};
+
+class Propagator
+{
+   public:
+    Propagator(CFG &cfg, common::Interner &names);
+
+    // Finds what is known of every value, and the blocks and edges that
+    // may be taken.
+    void run();
+    // Rewrites the code with the constants found.
+    void rewrite();
+
+   private:
+    uint32_t value_of(Operand operand);
+    Lattice read(Operand operand) const;
+    void set(Operand dst, Lattice value);
+    // Marks the edge from `from` to `to` as taken, visiting `to` if it was
+    // not reached before, else its phis, which have one more value to join.
+    void take(uint32_t from, uint32_t to);
+    void visit(uint32_t block, uint32_t ix);
+
+    CFG &m_cfg;
+    common::Interner &m_names;
+    std::unordered_map<uint32_t, uint32_t> m_number;
+    std::vector<Lattice> m_values;
+    std::vector<std::vector<Site>> m_uses;
+    std::vector<bool> m_reached;
+    // per block, per predecessor, whether that edge is taken
+    std::vector<std::vector<bool>> m_taken;
+    std::vector<uint32_t> m_block_work;
+    std::vector<uint32_t> m_value_work;
+};
+
+Propagator::Propagator(CFG &cfg, common::Interner &names)
+    : m_cfg(cfg), m_names(names), m_reached(cfg.size()), m_taken(cfg.size())
+{
+    IRFunction &func = m_cfg.function();
+    std::vector<bool> defined;
+    for (uint32_t block : m_cfg.reverse_postorder())
+    {
+        m_taken[block].resize(m_cfg.block(block).preds.size());
+        std::vector<IRInstr> &code = m_cfg.block(block).code;
+        for (uint32_t ix = 0; ix < code.size(); ++ix)
+        {
+            func.for_each_use(
+                code[ix],
+                [&](Operand &use)
+                {
+                    uint32_t value = value_of(use);
+                    if (value != UINT32_MAX)
+                    {
+                        m_uses[value].push_back({block, ix});
+                    }
+                }
+            );
+            Operand *dst = code[ix].dst();
+            uint32_t value = dst != nullptr ? value_of(*dst) : UINT32_MAX;
+            if (value != UINT32_MAX)
+            {
+                defined.resize(m_values.size());
+                defined[value] = true;
+            }
+        }
+    }
+
+    // values no instruction defines hold whatever their storage did
+    defined.resize(m_values.size());
+    for (uint32_t value = 0; value < m_values.size(); ++value)
+    {
+        if (!defined[value])
+        {
+            m_values[value] = Lattice::varying();
+        }
+    }
+}
+
+uint32_t Propagator::value_of(Operand operand)
+{
+    if (!is_ssa_value(operand))
+    {
+        return UINT32_MAX;
+    }
+    auto [it, added] = m_number.try_emplace(
+        operand.id, static_cast<uint32_t>(m_values.size())
+    );
+    if (added)
+    {
+        m_values.emplace_back();
+        m_uses.emplace_back();
+    }
+    return it->second;
+}
+
+Lattice Propagator::read(Operand operand) const
+{
+    if (operand.is_immediate())
+    {
+        return Lattice::of(operand.value(m_names));
+    }
+    if (is_ssa_value(operand))
+    {
+        return m_values[m_number.at(operand.id)];
+    }
+    // memory, which other code may change
+    return Lattice::varying();
+}
+
+void Propagator::set(Operand dst, Lattice value)
+{
+    if (!is_ssa_value(dst))
+    {
+        return;
+    }
+    uint32_t number = m_number.at(dst.id);
+    if (m_values[number] != value)
+    {
+        m_values[number] = value;
+        m_value_work.push_back(number);
+    }
+}
+
+void Propagator::take(uint32_t from, uint32_t to)
+{
+    std::vector<uint32_t> const &preds = m_cfg.block(to).preds;
+    bool added = false;
+    for (size_t pred = 0; pred < preds.size(); ++pred)
+    {
+        if (preds[pred] == from && !m_taken[to][pred])
+        {
+            m_taken[to][pred] = true;
+            added = true;
+        }
+    }
+    if (!added)
+    {
+        return;
+    }
+    if (!m_reached[to])
+    {
+        m_reached[to] = true;
+        m_block_work.push_back(to);
+        return;
+    }
+    std::vector<IRInstr> const &code = m_cfg.block(to).code;
+    for (uint32_t ix = 0; ix < code.size(); ++ix)
+    {
+        if (code[ix].kind == IRType::Phi)
+        {
+            visit(to, ix);
+        }
+    }
+}
+
+void Propagator::visit(uint32_t block, uint32_t ix)
+{
+    IRFunction &func = m_cfg.function();
+    IRInstr &instr = m_cfg.block(block).code[ix];
+    switch (instr.kind)
+    {
+    case IRType::Assign:
+        set(instr.variant.assign.dst, read(instr.variant.assign.src));
+        break;
+    case IRType::BinaryOp:
+    case IRType::UnaryOp:
+    {
+        bool binary = instr.kind == IRType::BinaryOp;
+        IROp op = binary ? instr.variant.binaryOp.op : instr.variant.unaryOp.op;
+        Lattice left = read(
+            binary ? instr.variant.binaryOp.left : instr.variant.unaryOp.value
+        );
+        Lattice right = binary ? read(instr.variant.binaryOp.right) : left;
+        Lattice result = Lattice::varying();
+        int64_t folded = 0;
+        if (left.state == Lattice::State::Varying ||
+            right.state == Lattice::State::Varying)
+        {
+            result = Lattice::varying();
+        }
+        else if (!left.is_constant() || !right.is_constant())
+        {
+            result = Lattice();
+        }
+        else if (fold(op, left.constant, right.constant, folded))
+        {
+            result = Lattice::of(folded);
+        }
+        set(*instr.dst(), result);
+        break;
+    }
+    case IRType::Phi:
+    {
+        Lattice result;
+        std::span<Operand const> args = func.args(instr.variant.phi);
+        for (size_t arg = 0; arg < args.size(); ++arg)
+        {
+            if (m_taken[block][arg] && !args[arg].is_none())
+            {
+                result = result.meet(read(args[arg]));
+            }
+        }
+        set(instr.variant.phi.dst, result);
+        break;
+    }
+    case IRType::Call:
+        set(instr.variant.call.dst, Lattice::varying());
+        break;
+    case IRType::IfFalseGoto:
+    {
+        Lattice condition = read(instr.variant.ifFalseGoto.condition);
+        std::vector<uint32_t> const &succs = m_cfg.block(block).succs;
+        if (condition.state == Lattice::State::Varying)
+        {
+            take(block, succs[0]);
+            take(block, succs[1]);
+        }
+        else if (condition.is_constant())
+        {
+            take(block, succs[condition.constant == 0 ? 1 : 0]);
+        }
+        break;
+    }
+    case IRType::Goto:
+    case IRType::Label:
+    case IRType::Print:
+    case IRType::Return:
+    case IRType::Nop:
+        break;
+    }
+}
+
+void Propagator::run()
+{
+    m_reached[CFG::entry] = true;
+    m_block_work.push_back(CFG::entry);
+    while (!m_block_work.empty() || !m_value_work.empty())
+    {
+        if (!m_block_work.empty())
+        {
+            uint32_t block = m_block_work.back();
+            m_block_work.pop_back();
+            std::vector<IRInstr> const &code = m_cfg.block(block).code;
+            for (uint32_t ix = 0; ix < code.size(); ++ix)
+            {
+                visit(block, ix);
+            }
+            // branches take their edges when visited
+            if (code.empty() || code.back().kind != IRType::IfFalseGoto)
+            {
+                for (uint32_t succ : m_cfg.block(block).succs)
+                {
+                    take(block, succ);
+                }
+            }
+            continue;
+        }
+
+        uint32_t value = m_value_work.back();
+        m_value_work.pop_back();
+        for (Site use : m_uses[value])
+        {
+            if (m_reached[use.block])
+            {
+                visit(use.block, use.ix);
+            }
+        }
+    }
+}
+
+void Propagator::rewrite()
+{
+    // Folding the branches leaves only edges that are taken, so the
+    // blocks never reached become unreachable.
+    for (uint32_t block = 0; block < m_cfg.size(); ++block)
+    {
+        std::vector<IRInstr> const &code = m_cfg.block(block).code;
+        if (!m_reached[block] || code.empty() ||
+            code.back().kind != IRType::IfFalseGoto)
+        {
+            continue;
+        }
+        Lattice condition = read(code.back().variant.ifFalseGoto.condition);
+        if (condition.is_constant())
+        {
+            m_cfg.fold_branch(block, condition.constant == 0);
+        }
+    }
+    m_cfg.remove_unreachable();
+
+    IRFunction &func = m_cfg.function();
+    auto constant = [&](Operand operand)
+    { return is_ssa_value(operand) && read(operand).is_constant(); };
+    auto replace = [&](Operand &operand)
+    {
+        if (constant(operand))
+        {
+            operand = Operand::immediate(read(operand).constant, m_names);
+        }
+    };
+    for (uint32_t block : m_cfg.reverse_postorder())
+    {
+        std::vector<IRInstr> &code = m_cfg.block(block).code;
+        for (IRInstr &instr : code)
+        {
+            func.for_each_use(instr, replace);
+        }
+        // every read of these is an immediate now
+        std::erase_if(
+            code,
+            [&](IRInstr const &instr)
+            {
+                Operand const *dst = instr.dst();
+                return dst != nullptr && constant(*dst);
+            }
+        );
+    }
+}
+}  // namespace
+
+void propagate_constants(CFG &cfg, IRContext &context)
+{
+    Propagator propagator(cfg, context.names);
+    propagator.run();
+    propagator.rewrite();
+}
@@ -0,0 +1,17 @@
+#ifndef SCCP_HPP
+#define SCCP_HPP
+
+#include "cfg.hpp"
+#include "irgenerator.hpp"
+
+// Sparse conditional constant propagation over code in SSA form. Values
+// are assumed constant until shown otherwise, and only the blocks reached
+// so far count, so a value may be found constant because the code making
+// it vary never runs. Constant values are replaced by immediates and their
+// definitions dropped, branches on them are folded and the blocks no
+// longer reached removed. The arithmetic wraps around at 64 bits like that
+// of the generated code, and operators the code generator does not
+// implement are never folded.
+void propagate_constants(CFG &cfg, IRContext &context);
+
+#endif
@@ -0,0 +1,839 @@
+#include "ssa.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <numeric>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cfg.hpp"
+#include "common/irinstructions.hpp"
+
+namespace
+{
+// temporaries and variables hashed together
+uint64_t key(Operand operand)
+{
+    return static_cast<uint64_t>(operand.kind) << 32 | operand.id;
+}
+
+// A temporary or variable being promoted.
+struct Candidate
+{
+    Operand original;
+    // the blocks writing it, each once
+    std::vector<uint32_t> def_blocks;
+    uint32_t defs = 0;
+    // read in a block before being written there, so its values flow from
+    // block to block
+    bool live_across = false;
+    // renamed at every write, which temporaries written once need not be
+    bool renamed = false;
+};
+
+// The index after the labels of a block, where its phis start.
+size_t phi_position(std::vector<IRInstr> const &code)
+{
+    size_t ix = 0;
+    while (ix < code.size() && code[ix].kind == IRType::Label)
+    {
+        ++ix;
+    }
+    return ix;
+}
+
+// The index of the jump or return closing a block, or its end.
+size_t exit_position(std::vector<IRInstr> const &code)
+{
+    bool jumps = !code.empty() && (code.back().kind == IRType::Goto ||
+                                   code.back().kind == IRType::IfFalseGoto ||
+                                   code.back().kind == IRType::Return);
+    return code.size() - (jumps ? 1 : 0);
+}
+
+// Per block, the blocks where its dominance ends: those it does not
+// strictly dominate, but one of whose predecessors it dominates.
+std::vector<std::vector<uint32_t>> dominance_frontiers(CFG &cfg)
+{
+    std::vector<std::vector<uint32_t>> frontier(cfg.size());
+    for (uint32_t block : cfg.reverse_postorder())
+    {
+        std::vector<uint32_t> const &preds = cfg.block(block).preds;
+        if (preds.size() < 2)
+        {
+            continue;
+        }
+        for (uint32_t pred : preds)
+        {
+            for (uint32_t runner = pred; runner != cfg.idom(block);
+                 runner = cfg.idom(runner))
+            {
+                if (frontier[runner].empty() ||
+                    frontier[runner].back() != block)
+                {
+                    frontier[runner].push_back(block);
+                }
+            }
+        }
+    }
+    return frontier;
+}
+
+// Removes the phis no instruction but a dead phi reads.
+void remove_dead_phis(CFG &cfg)
+{
+    IRFunction &func = cfg.function();
+    std::unordered_map<uint32_t, size_t> phi_of;
+    std::vector<std::pair<uint32_t, size_t>> sites;
+    for (uint32_t block : cfg.reverse_postorder())
+    {
+        std::vector<IRInstr> &code = cfg.block(block).code;
+        size_t first = phi_position(code);
+        for (size_t ix = first; ix < first + cfg.phis(block).size(); ++ix)
+        {
+            phi_of[code[ix].variant.phi.dst.id] = sites.size();
+            sites.push_back({block, ix});
+        }
+    }
+    if (sites.empty())
+    {
+        return;
+    }
+
+    std::vector<bool> live(sites.size());
+    std::vector<size_t> work;
+    auto mark = [&](Operand &use)
+    {
+        if (use.kind != OperandKind::Temp)
+        {
+            return;
+        }
+        auto it = phi_of.find(use.id);
+        if (it != phi_of.end() && !live[it->second])
+        {
+            live[it->second] = true;
+            work.push_back(it->second);
+        }
+    };
+    for (uint32_t block : cfg.reverse_postorder())
+    {
+        for (IRInstr &instr : cfg.block(block).code)
+        {
+            if (instr.kind != IRType::Phi)
+            {
+                func.for_each_use(instr, mark);
+            }
+        }
+    }
+    while (!work.empty())
+    {
+        auto [block, ix] = sites[work.back()];
+        work.pop_back();
+        func.for_each_use(cfg.block(block).code[ix], mark);
+    }
+
+    for (uint32_t block : cfg.reverse_postorder())
+    {
+        std::erase_if(
+            cfg.block(block).code,
+            [&](IRInstr const &instr)
+            {
+                return instr.kind == IRType::Phi &&
+                       !live[phi_of[instr.variant.phi.dst.id]];
+            }
+        );
+    }
+}
+
+// Where a value is defined, its instruction or the entry, for values no
+// instruction writes.
+struct Site
+{
+    uint32_t block;
+    uint32_t ix;
+
+    bool operator<(Site const &other) const
+    {
+        return block != other.block ? block < other.block : ix < other.ix;
+    }
+};
+
+struct Value
+{
+    Operand operand;
+    Site def = {no_block, 0};
+    // sorted; a phi reads its arguments at the end of the predecessors,
+    // past their last instruction
+    std::vector<Site> uses;
+    // sorted blocks on whose entry and exit the value is live
+    std::vector<uint32_t> live_in;
+    std::vector<uint32_t> live_out;
+};
+
+// Values, their liveness and the sets of values to share a temporary.
+class Coalescer
+{
+   public:
+    Coalescer(CFG &cfg) : m_cfg(cfg) {}
+
+    void number();
+    void compute_liveness();
+    // Merges the sets of two values, if their values do not interfere or
+    // `always`.
+    void merge(Operand a, Operand b, bool always);
+    // The temporary of each value's set: the one live on entry, if any,
+    // which has to keep its storage, else that numbered lowest.
+    void rename();
+
+   private:
+    uint32_t value_of(Operand operand);
+    bool dominates(Site a, Site b);
+    // whether `value` is still read after `site`
+    bool live_after(uint32_t value, Site site);
+    // Whether any values of the two sets interfere. As each set is free of
+    // interference, that only needs checking between each value and the
+    // closest one in either set whose definition dominates it.
+    bool interfere(
+        std::vector<uint32_t> const &a, std::vector<uint32_t> const &b
+    );
+
+    CFG &m_cfg;
+    std::unordered_map<uint32_t, uint32_t> m_number;
+    std::vector<Value> m_values;
+    // preorder of the dominator tree, and per value where that puts its
+    // definition
+    std::vector<uint32_t> m_preorder;
+    std::vector<uint64_t> m_rank;
+    std::vector<uint32_t> m_leader;
+    // per leader, the members sorted by where they are defined
+    std::vector<std::vector<uint32_t>> m_members;
+};
+
+uint32_t Coalescer::value_of(Operand operand)
+{
+    auto [it, added] = m_number.try_emplace(
+        operand.id, static_cast<uint32_t>(m_values.size())
+    );
+    if (added)
+    {
+        m_values.emplace_back();
+        m_values.back().operand = operand;
+    }
+    return it->second;
+}
+
+void Coalescer::number()
+{
+    IRFunction &func = m_cfg.function();
+    for (uint32_t block : m_cfg.reverse_postorder())
+    {
+        std::vector<IRInstr> &code = m_cfg.block(block).code;
+        for (uint32_t ix = 0; ix < code.size(); ++ix)
+        {
+            IRInstr &instr = code[ix];
+            if (instr.kind == IRType::Phi)
+            {
+                std::span<Operand> args = func.args(instr.variant.phi);
+                for (size_t arg = 0; arg < args.size(); ++arg)
+                {
+                    if (is_ssa_value(args[arg]))
+                    {
+                        uint32_t pred = m_cfg.block(block).preds[arg];
+                        uint32_t end = static_cast<uint32_t>(
+                            m_cfg.block(pred).code.size()
+                        );
+                        uint32_t value = value_of(args[arg]);
+                        m_values[value].uses.push_back({pred, end});
+                    }
+                }
+            }
+            else
+            {
+                func.for_each_use(
+                    instr,
+                    [&](Operand &use)
+                    {
+                        if (is_ssa_value(use))
+                        {
+                            uint32_t value = value_of(use);
+                            m_values[value].uses.push_back({block, ix});
+                        }
+                    }
+                );
+            }
+            Operand *dst = instr.dst();
+            if (dst != nullptr && is_ssa_value(*dst))
+            {
+                uint32_t value = value_of(*dst);
+                m_values[value].def = {block, ix};
+            }
+        }
+    }
+
+    m_preorder.assign(m_cfg.size(), 0);
+    uint32_t clock = 0;
+    std::vector<uint32_t> stack = {CFG::entry};
+    while (!stack.empty())
+    {
+        uint32_t block = stack.back();
+        stack.pop_back();
+        m_preorder[block] = clock++;
+        for (uint32_t child : m_cfg.dom_children(block))
+        {
+            stack.push_back(child);
+        }
+    }
+
+    m_rank.resize(m_values.size());
+    m_leader.resize(m_values.size());
+    std::iota(m_leader.begin(), m_leader.end(), 0);
+    m_members.resize(m_values.size());
+    for (uint32_t value = 0; value < m_values.size(); ++value)
+    {
+        Value &v = m_values[value];
+        std::sort(v.uses.begin(), v.uses.end());
+        m_rank[value] = v.def.block == no_block
+                            ? 0
+                            : (uint64_t{m_preorder[v.def.block]} + 1) << 32 |
+                                  v.def.ix;
+        m_members[value] = {value};
+    }
+}
+
+// Walks back from every read of a value to its definition. The value is
+// live on entry of the blocks passed, and on exit of their predecessors.
+void Coalescer::compute_liveness()
+{
+    std::vector<uint32_t> in_mark(m_cfg.size());
+    std::vector<uint32_t> out_mark(m_cfg.size());
+    std::vector<uint32_t> work;
+    for (uint32_t ix = 0; ix < m_values.size(); ++ix)
+    {
+        Value &value = m_values[ix];
+        uint32_t mark = ix + 1;
+        auto live_out = [&](uint32_t block)
+        {
+            if (out_mark[block] != mark)
+            {
+                out_mark[block] = mark;
+                value.live_out.push_back(block);
+            }
+        };
+        auto live_in = [&](uint32_t block)
+        {
+            if (block != value.def.block && in_mark[block] != mark)
+            {
+                in_mark[block] = mark;
+                value.live_in.push_back(block);
+                work.push_back(block);
+            }
+        };
+
+        for (Site use : value.uses)
+        {
+            if (use.ix == m_cfg.block(use.block).code.size())
+            {
+                live_out(use.block);
+            }
+            live_in(use.block);
+        }
+        while (!work.empty())
+        {
+            uint32_t block = work.back();
+            work.pop_back();
+            for (uint32_t pred : m_cfg.block(block).preds)
+            {
+                live_out(pred);
+                live_in(pred);
+            }
+        }
+        std::sort(value.live_in.begin(), value.live_in.end());
+        std::sort(value.live_out.begin(), value.live_out.end());
+    }
+}
+
+bool Coalescer::dominates(Site a, Site b)
+{
+    if (a.block == no_block || b.block == no_block)
+    {
+        return a.block == no_block;
+    }
+    if (a.block == b.block)
+    {
+        return a.ix < b.ix;
+    }
+    return m_cfg.dominates(a.block, b.block);
+}
+
+bool Coalescer::live_after(uint32_t value, Site site)
+{
+    Value const &v = m_values[value];
+    if (site.block == no_block)
+    {
+        return !v.uses.empty();
+    }
+    if (std::binary_search(v.live_out.begin(), v.live_out.end(), site.block))
+    {
+        return true;
+    }
+    // the last read in the block of `site`
+    auto last = std::upper_bound(
+        v.uses.begin(), v.uses.end(), Site{site.block, UINT32_MAX}
+    );
+    return last != v.uses.begin() && (last - 1)->block == site.block &&
+           (last - 1)->ix > site.ix;
+}
+
+bool Coalescer::interfere(
+    std::vector<uint32_t> const &a, std::vector<uint32_t> const &b
+)
+{
+    auto earlier = [&](uint32_t x, uint32_t y)
+    { return m_rank[x] < m_rank[y]; };
+    std::vector<uint32_t> values;
+    std::merge(
+        a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(values),
+        earlier
+    );
+
+    std::vector<uint32_t> dominating;
+    for (uint32_t value : values)
+    {
+        Site def = m_values[value].def;
+        while (!dominating.empty() &&
+               !dominates(m_values[dominating.back()].def, def))
+        {
+            dominating.pop_back();
+        }
+        if (!dominating.empty() && live_after(dominating.back(), def))
+        {
+            return true;
+        }
+        dominating.push_back(value);
+    }
+    return false;
+}
+
+void Coalescer::merge(Operand a, Operand b, bool always)
+{
+    uint32_t x = m_leader[m_number[a.id]];
+    uint32_t y = m_leader[m_number[b.id]];
+    if (x == y || (!always && interfere(m_members[x], m_members[y])))
+    {
+        return;
+    }
+    // the smaller set joins the bigger one
+    if (m_members[x].size() < m_members[y].size())
+    {
+        std::swap(x, y);
+    }
+    std::vector<uint32_t> members;
+    std::merge(
+        m_members[x].begin(), m_members[x].end(), m_members[y].begin(),
+        m_members[y].end(), std::back_inserter(members),
+        [&](uint32_t p, uint32_t q) { return m_rank[p] < m_rank[q]; }
+    );
+    for (uint32_t value : m_members[y])
+    {
+        m_leader[value] = x;
+    }
+    m_members[x] = std::move(members);
+    m_members[y] = {};
+}
+
+void Coalescer::rename()
+{
+    std::vector<Operand> name(m_values.size());
+    for (uint32_t leader = 0; leader < m_values.size(); ++leader)
+    {
+        if (m_members[leader].empty())
+        {
+            continue;
+        }
+        Operand chosen = m_values[m_members[leader][0]].operand;
+        for (uint32_t value : m_members[leader])
+        {
+            Value const &v = m_values[value];
+            if (v.def.block == no_block && !v.uses.empty())
+            {
+                chosen = v.operand;
+                break;
+            }
+            chosen.id = std::min(chosen.id, v.operand.id);
+        }
+        for (uint32_t value : m_members[leader])
+        {
+            name[value] = chosen;
+        }
+    }
+
+    IRFunction &func = m_cfg.function();
+    auto rename = [&](Operand &operand)
+    {
+        if (is_ssa_value(operand))
+        {
+            operand = name[m_number[operand.id]];
+        }
+    };
+    for (uint32_t block : m_cfg.reverse_postorder())
+    {
+        std::vector<IRInstr> &code = m_cfg.block(block).code;
+        for (IRInstr &instr : code)
+        {
+            func.for_each_use(instr, rename);
+            if (Operand *dst = instr.dst())
+            {
+                rename(*dst);
+            }
+        }
+        std::erase_if(
+            code,
+            [](IRInstr const &instr)
+            {
+                return instr.kind == IRType::Phi ||
+                       (instr.kind == IRType::Assign &&
+                        instr.variant.assign.dst == instr.variant.assign.src);
+            }
+        );
+    }
+}
+}  // namespace
+
+void construct_ssa(
+    CFG &cfg, IRContext &context, std::span<common::Symbol const> promoted
+)
+{
+    IRFunction &func = cfg.function();
+    cfg.remove_unreachable();
+    std::span<uint32_t const> order = cfg.reverse_postorder();
+
+    std::unordered_map<uint64_t, uint32_t> index;
+    std::vector<Candidate> candidates;
+    // per candidate, the last block that wrote it, plus one
+    std::vector<uint32_t> written;
+    auto find = [&](Operand operand)
+    {
+        auto it = index.find(key(operand));
+        return it == index.end() ? UINT32_MAX : it->second;
+    };
+    // temporaries are found as they show up
+    auto candidate = [&](Operand operand)
+    {
+        if (!is_ssa_value(operand))
+        {
+            return operand.kind == OperandKind::Var ? find(operand)
+                                                    : UINT32_MAX;
+        }
+        auto [it, added] = index.try_emplace(
+            key(operand), static_cast<uint32_t>(candidates.size())
+        );
+        if (added)
+        {
+            candidates.emplace_back();
+            candidates.back().original = operand;
+            written.push_back(0);
+        }
+        return it->second;
+    };
+    for (common::Symbol var : promoted)
+    {
+        index.emplace(key(Operand::var(var)), candidates.size());
+        candidates.emplace_back();
+        candidates.back().original = Operand::var(var);
+        written.push_back(0);
+    }
+
+    for (uint32_t block : order)
+    {
+        for (IRInstr &instr : cfg.block(block).code)
+        {
+            func.for_each_use(
+                instr,
+                [&](Operand &use)
+                {
+                    uint32_t ix = candidate(use);
+                    if (ix != UINT32_MAX && written[ix] != block + 1)
+                    {
+                        candidates[ix].live_across = true;
+                    }
+                }
+            );
+            Operand *dst = instr.dst();
+            uint32_t ix = dst != nullptr ? candidate(*dst) : UINT32_MAX;
+            if (ix == UINT32_MAX)
+            {
+                continue;
+            }
+            ++candidates[ix].defs;
+            if (written[ix] != block + 1)
+            {
+                written[ix] = block + 1;
+                candidates[ix].def_blocks.push_back(block);
+            }
+        }
+    }
+
+    // Phis go to the iterated dominance frontier of the writes, for the
+    // candidates whose values flow between blocks at all.
+    std::vector<std::vector<uint32_t>> frontier = dominance_frontiers(cfg);
+    // per block, the candidates its phis join in order
+    std::vector<std::vector<uint32_t>> joins(cfg.size());
+    // per block, the last candidate given a phi or queued there, plus one
+    std::vector<uint32_t> has_phi(cfg.size());
+    std::vector<uint32_t> queued(cfg.size());
+    std::vector<uint32_t> work;
+    for (uint32_t ix = 0; ix < candidates.size(); ++ix)
+    {
+        Candidate &c = candidates[ix];
+        c.renamed = c.original.kind == OperandKind::Var || c.defs > 1;
+        if (!c.renamed || !c.live_across)
+        {
+            continue;
+        }
+        for (uint32_t block : c.def_blocks)
+        {
+            queued[block] = ix + 1;
+            work.push_back(block);
+        }
+        while (!work.empty())
+        {
+            uint32_t block = work.back();
+            work.pop_back();
+            for (uint32_t join : frontier[block])
+            {
+                if (has_phi[join] == ix + 1)
+                {
+                    continue;
+                }
+                has_phi[join] = ix + 1;
+                joins[join].push_back(ix);
+                if (queued[join] != ix + 1)
+                {
+                    queued[join] = ix + 1;
+                    work.push_back(join);
+                }
+            }
+        }
+    }
+    for (uint32_t block : order)
+    {
+        if (joins[block].empty())
+        {
+            continue;
+        }
+        std::vector<Operand> args(cfg.block(block).preds.size());
+        std::vector<IRInstr> phis;
+        for (uint32_t ix : joins[block])
+        {
+            std::fill(args.begin(), args.end(), candidates[ix].original);
+            phis.push_back(PhiIR(
+                candidates[ix].original, func.add_list(args),
+                static_cast<uint32_t>(args.size())
+            ));
+        }
+        std::vector<IRInstr> &code = cfg.block(block).code;
+        code.insert(
+            code.begin() + phi_position(code), phis.begin(), phis.end()
+        );
+    }
+
+    // Renames along the dominator tree, so the value of a candidate at any
+    // point is the last one defined on the path from the entry. Before any,
+    // that is the candidate itself, read for its value on entry.
+    std::vector<std::vector<Operand>> stacks(candidates.size());
+    for (uint32_t ix = 0; ix < candidates.size(); ++ix)
+    {
+        stacks[ix].push_back(candidates[ix].original);
+    }
+    // the candidates defined on the path, to be popped on the way back
+    std::vector<uint32_t> defined;
+    auto rename = [&](Operand &operand)
+    {
+        uint32_t ix = operand.is_storage() ? find(operand) : UINT32_MAX;
+        if (ix != UINT32_MAX && candidates[ix].renamed)
+        {
+            operand = stacks[ix].back();
+        }
+    };
+    auto visit = [&](uint32_t block)
+    {
+        std::vector<IRInstr> &code = cfg.block(block).code;
+        size_t ix = phi_position(code);
+        for (uint32_t join : joins[block])
+        {
+            Operand value = context.new_temp();
+            code[ix++].variant.phi.dst = value;
+            stacks[join].push_back(value);
+            defined.push_back(join);
+        }
+        for (; ix < code.size(); ++ix)
+        {
+            func.for_each_use(code[ix], rename);
+            Operand *dst = code[ix].dst();
+            uint32_t c = dst != nullptr ? find(*dst) : UINT32_MAX;
+            if (c != UINT32_MAX && candidates[c].renamed)
+            {
+                *dst = context.new_temp();
+                stacks[c].push_back(*dst);
+                defined.push_back(c);
+            }
+        }
+
+        for (uint32_t succ : cfg.block(block).succs)
+        {
+            std::vector<uint32_t> const &preds = cfg.block(succ).preds;
+            size_t edge =
+                std::find(preds.begin(), preds.end(), block) - preds.begin();
+            std::span<IRInstr> phis = cfg.phis(succ);
+            for (size_t phi = 0; phi < joins[succ].size(); ++phi)
+            {
+                func.args(phis[phi].variant.phi)[edge] =
+                    stacks[joins[succ][phi]].back();
+            }
+        }
+    };
+
+    struct Frame
+    {
+        uint32_t block;
+        size_t child;
+        size_t defined;
+    };
+    std::vector<Frame> path = {{CFG::entry, 0, 0}};
+    visit(CFG::entry);
+    while (!path.empty())
+    {
+        Frame &frame = path.back();
+        std::span<uint32_t const> children = cfg.dom_children(frame.block);
+        if (frame.child < children.size())
+        {
+            uint32_t child = children[frame.child++];
+            path.push_back({child, 0, defined.size()});
+            visit(child);
+            continue;
+        }
+        for (size_t ix = frame.defined; ix < defined.size(); ++ix)
+        {
+            stacks[defined[ix]].pop_back();
+        }
+        defined.resize(frame.defined);
+        path.pop_back();
+    }
+
+    remove_dead_phis(cfg);
+}
+
+void destruct_ssa(CFG &cfg, IRContext &context)
+{
+    IRFunction &func = cfg.function();
+    cfg.remove_unreachable();
+    std::span<uint32_t const> order = cfg.reverse_postorder();
+
+    // Each `d = phi(a...)` becomes `d' = phi(a'...)` and `d = d'` after the
+    // phis, with copies `a' = a` closing the predecessors. The new
+    // temporaries are live only at the edges into the block, so the phi
+    // and all its copies can share one temporary without interfering.
+    std::vector<std::vector<Operand>> webs;
+    for (uint32_t block : order)
+    {
+        size_t first = phi_position(cfg.block(block).code);
+        size_t count = cfg.phis(block).size();
+        std::vector<IRInstr> after;
+        for (size_t ix = first; ix < first + count; ++ix)
+        {
+            // predecessors are copied into, possibly this block
+            PhiIR phi = cfg.block(block).code[ix].variant.phi;
+            Operand joined = context.new_temp();
+            after.push_back(AssignIR(phi.dst, joined));
+            cfg.block(block).code[ix].variant.phi.dst = joined;
+            std::vector<Operand> web = {joined};
+
+            std::span<Operand> args = func.args(phi);
+            for (size_t arg = 0; arg < args.size(); ++arg)
+            {
+                if (args[arg].is_none())
+                {
+                    continue;
+                }
+                Operand copy = context.new_temp();
+                std::vector<IRInstr> &code =
+                    cfg.block(cfg.block(block).preds[arg]).code;
+                code.insert(
+                    code.begin() + exit_position(code),
+                    AssignIR(copy, args[arg])
+                );
+                args[arg] = copy;
+                web.push_back(copy);
+            }
+            webs.push_back(std::move(web));
+        }
+        std::vector<IRInstr> &code = cfg.block(block).code;
+        code.insert(code.begin() + first + count, after.begin(), after.end());
+    }
+
+    Coalescer coalescer(cfg);
+    coalescer.number();
+    coalescer.compute_liveness();
+    for (std::vector<Operand> const &web : webs)
+    {
+        for (Operand copy : web)
+        {
+            coalescer.merge(web[0], copy, true);
+        }
+    }
+
+    // the copies in the innermost loops first, whose removal saves most
+    struct Copy
+    {
+        Operand dst;
+        Operand src;
+        uint32_t depth;
+    };
+    std::vector<Copy> copies;
+    for (uint32_t block : order)
+    {
+        uint32_t loop = cfg.loop_of(block);
+        uint32_t depth = loop == no_loop ? 0 : cfg.loops()[loop].depth;
+        for (IRInstr const &instr : cfg.block(block).code)
+        {
+            if (instr.kind == IRType::Assign &&
+                is_ssa_value(instr.variant.assign.dst) &&
+                is_ssa_value(instr.variant.assign.src))
+            {
+                copies.push_back(
+                    {instr.variant.assign.dst, instr.variant.assign.src, depth}
+                );
+            }
+        }
+    }
+    std::stable_sort(
+        copies.begin(), copies.end(),
+        [](Copy const &a, Copy const &b) { return a.depth > b.depth; }
+    );
+    for (Copy const &copy : copies)
+    {
+        coalescer.merge(copy.dst, copy.src, false);
+    }
+    coalescer.rename();
+
+    // only calls keep argument lists now
+    std::vector<Operand> lists;
+    for (uint32_t block : order)
+    {
+        for (IRInstr &instr : cfg.block(block).code)
+        {
+            if (instr.kind == IRType::Call)
+            {
+                std::span<Operand const> args = func.args(instr.variant.call);
+                instr.variant.call.first_arg =
+                    static_cast<uint32_t>(lists.size());
+                lists.insert(lists.end(), args.begin(), args.end());
+            }
+        }
+    }
+    func.operand_lists = std::move(lists);
+}
@@ -0,0 +1,35 @@
+#ifndef SSA_HPP
+#define SSA_HPP
+
+#include <span>
+
+#include "cfg.hpp"
+#include "common/interner.hpp"
+#include "common/irinstructions.hpp"
+#include "irgenerator.hpp"
+
+// In SSA form every temporary but t0 is a value: written once, by an
+// instruction that dominates all its reads, or never and then read for
+// what its storage held on entry. Variables are memory, and so is t0, from
+// which the assembly reads the results of calls.
+inline bool is_ssa_value(Operand operand)
+{
+    return operand.kind == OperandKind::Temp && operand.id != 0;
+}
+
+// Puts the code of `cfg` in SSA form, after removing unreachable blocks.
+// The temporaries and the variables in `promoted` become values: every
+// write defines a new temporary, and phis join them at the iterated
+// dominance frontiers of those writes where they are live. A promoted
+// variable is then only read, for the value it had on entry, so it must
+// not be accessed by any other code that may run in between.
+void construct_ssa(
+    CFG &cfg, IRContext &context, std::span<common::Symbol const> promoted
+);
+
+// Leaves SSA form: every phi becomes copies at the end of its predecessors,
+// then values joined by copies or phis share a temporary wherever they are
+// never live at the same time, which makes most of those copies vanish.
+void destruct_ssa(CFG &cfg, IRContext &context);
+
+#endif
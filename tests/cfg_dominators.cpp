@@ -0,0 +1,211 @@
+// Checks the dominator and post-dominator trees of CFG against their
+// definitions, computed by brute force on the graphs of a few functions:
+// `a` dominates `b` if `b` can not be reached from the entry without
+// passing `a`, and post-dominates it if no block leaving the function can
+// be reached from `b` without passing `a`. The trees are checked again
+// after edits, which have to make them be computed anew.
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "analyzer.hpp"
+#include "cfg.hpp"
+#include "common/error.hpp"
+#include "common/interner.hpp"
+#include "irgenerator.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+
+static constexpr std::string_view source = R"(
+fn branches(a) {
+    if (a > 1) { print 1; } else { print 2; }
+    if (a) { print 3; }
+    print 4;
+}
+fn loops(n) {
+    let i = 0;
+    while (i < n) {
+        let j = 0;
+        while (j < i) {
+            if (j == 2) { print j; } else { j = j + 1; }
+            j = j + 1;
+        }
+        for (let k = 0; k < 3; k = k + 1) print k;
+        i = i + 1;
+    }
+    print i;
+}
+fn forever(n) {
+    print n;
+    while (1) {
+        if (n) { print 1; }
+    }
+}
+print 0;
+)";
+
+static size_t failures = 0;
+
+static void expect(bool holds, char const *what, uint32_t a, uint32_t b)
+{
+    if (!holds)
+    {
+        std::fprintf(stderr, "cfg_dominators: %s b%u b%u\n", what, a, b);
+        ++failures;
+    }
+}
+
+// The blocks reachable from `from` without passing `avoid`, following
+// successors.
+static std::vector<bool> reach(CFG &cfg, uint32_t from, uint32_t avoid)
+{
+    std::vector<bool> seen(cfg.size());
+    std::vector<uint32_t> work;
+    if (from != avoid)
+    {
+        seen[from] = true;
+        work.push_back(from);
+    }
+    while (!work.empty())
+    {
+        uint32_t block = work.back();
+        work.pop_back();
+        for (uint32_t succ : cfg.block(block).succs)
+        {
+            if (succ != avoid && !seen[succ])
+            {
+                seen[succ] = true;
+                work.push_back(succ);
+            }
+        }
+    }
+    return seen;
+}
+
+static bool leaves(CFG &cfg, uint32_t block)
+{
+    return cfg.block(block).succs.empty();
+}
+
+static bool exits_without(CFG &cfg, uint32_t from, uint32_t avoid)
+{
+    std::vector<bool> seen = reach(cfg, from, avoid);
+    for (uint32_t block = 0; block < cfg.size(); ++block)
+    {
+        if (seen[block] && leaves(cfg, block))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The immediate one of `strict`, the strict (post-)dominators of a block:
+// the one all others (post-)dominate.
+template <typename Above>
+static uint32_t immediate(std::vector<uint32_t> const &strict, Above above)
+{
+    for (uint32_t candidate : strict)
+    {
+        bool lowest = true;
+        for (uint32_t other : strict)
+        {
+            lowest = lowest && above(other, candidate);
+        }
+        if (lowest)
+        {
+            return candidate;
+        }
+    }
+    return no_block;
+}
+
+static void check(CFG &cfg)
+{
+    std::vector<bool> reachable = reach(cfg, CFG::entry, no_block);
+    auto dominates = [&](uint32_t a, uint32_t b)
+    { return a == b || !reach(cfg, CFG::entry, a)[b]; };
+    auto post_dominates = [&](uint32_t a, uint32_t b)
+    { return a == b || !exits_without(cfg, b, a); };
+
+    for (uint32_t b = 0; b < cfg.size(); ++b)
+    {
+        if (!reachable[b] || cfg.block(b).removed)
+        {
+            continue;
+        }
+        std::vector<uint32_t> dominators;
+        std::vector<uint32_t> post_dominators;
+        for (uint32_t a = 0; a < cfg.size(); ++a)
+        {
+            if (!reachable[a] || cfg.block(a).removed)
+            {
+                continue;
+            }
+            expect(
+                cfg.dominates(a, b) == dominates(a, b), "dominates", a, b
+            );
+            if (a != b && dominates(a, b))
+            {
+                dominators.push_back(a);
+            }
+            // blocks that never leave the function are post-dominated by
+            // nothing, which the definition can not tell
+            if (exits_without(cfg, b, no_block))
+            {
+                expect(
+                    cfg.post_dominates(a, b) == post_dominates(a, b),
+                    "post_dominates", a, b
+                );
+                if (a != b && post_dominates(a, b))
+                {
+                    post_dominators.push_back(a);
+                }
+            }
+        }
+        uint32_t idom = immediate(dominators, dominates);
+        uint32_t ipdom = immediate(post_dominators, post_dominates);
+        expect(cfg.idom(b) == idom, "idom", b, idom);
+        expect(cfg.ipdom(b) == ipdom, "ipdom", b, ipdom);
+    }
+}
+
+int main()
+{
+    std::string diagnostics;
+    error::DiagnosticEngine engine(diagnostics);
+    engine.set_source(source);
+    common::Interner interner;
+    Lexer lexer(source, interner);
+    Parser parser(lexer, source);
+    Ast ast = parser.parse();
+    Analyzer analyzer(ast);
+    analyzer.analyze();
+    IRGenerator generator(ast, interner);
+    IRProgram ir = generator.generate();
+
+    size_t graphs = 0;
+    for (IRFunction &func : ir.functions)
+    {
+        CFG cfg(func, generator.context());
+        check(cfg);
+        // edits only mark the trees stale
+        for (Loop const &loop : std::vector<Loop>(
+                 cfg.loops().begin(), cfg.loops().end()
+             ))
+        {
+            cfg.add_preheader(loop.header);
+        }
+        check(cfg);
+        std::vector<uint32_t> succs = cfg.block(CFG::entry).succs;
+        cfg.split_edge(CFG::entry, succs[0]);
+        check(cfg);
+        ++graphs;
+    }
+
+    std::printf("cfg_dominators: %zu graphs\n", graphs);
+    return failures == 0 ? 0 : 1;
+}
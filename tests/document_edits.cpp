@@ -0,0 +1,95 @@
+// Checks that a Document reports the same for its text however it got
+// there: random edits are replayed on a few sources, and after every one
+// the parts and diagnostics have to be those of a Document opened afresh
+// with the same text. The edits favour what changes where parts begin,
+// like typing into a `fn` or opening a brace or comment.
+
+#include <cstddef>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common/error.hpp"
+#include "document.hpp"
+
+static constexpr std::string_view sources[] = {
+    "print y;\nfn g() {}\n",
+    "let x = 1;\nfn f(a) { print a + x; }\nfn g() { f(2); }\nprint x;\n",
+    "fn a() { let y = 2; }\nlet y = 3;\nfn b(n) {\n    while (n) { n = n - 1; }"
+    "\n}\nfn c() { print y; }\nb(y);\n",
+    "// fn\nlet fnx = 1;\nfn d() { print fnx; }\n/* fn e() {} */ d();\n",
+};
+
+// What the edits insert.
+static constexpr std::string_view snippets[] = {
+    "",   "f",      "n",    "fn",  "fn ", "y", "x", " ",   "\n",
+    "{",  "}",      ";",    "(",   ")",   "/", "*", "//",  "/*",
+    "*/", "print", "let ", "= 1", "fn h() { print x; }\n",
+};
+
+static bool same(
+    std::vector<error::Diagnostic> const &a,
+    std::vector<error::Diagnostic> const &b
+)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+    for (size_t ix = 0; ix < a.size(); ++ix)
+    {
+        if (a[ix].offset != b[ix].offset || a[ix].message != b[ix].message)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    std::mt19937 random(1);
+    size_t sequences = 0;
+    size_t failures = 0;
+    for (std::string_view source : sources)
+    {
+        for (size_t run = 0; run < 100; ++run, ++sequences)
+        {
+            Document document{std::string(source)};
+            for (size_t step = 0; step < 8; ++step)
+            {
+                size_t size = document.text().size();
+                size_t offset = random() % (size + 1);
+                size_t removed = random() % 4;
+                if (removed > size - offset)
+                {
+                    removed = size - offset;
+                }
+                std::string_view inserted =
+                    snippets[random() % std::size(snippets)];
+                std::string before(document.text());
+                document.edit(offset, removed, inserted);
+
+                Document fresh{std::string(document.text())};
+                if (document.part_count() != fresh.part_count() ||
+                    !same(document.diagnostics(), fresh.diagnostics()))
+                {
+                    std::fprintf(
+                        stderr,
+                        "document_edits: edit {%zu, %zu, \"%.*s\"} of\n%s\n",
+                        offset, removed,
+                        static_cast<int>(inserted.size()), inserted.data(),
+                        before.c_str()
+                    );
+                    ++failures;
+                    break;
+                }
+            }
+        }
+    }
+
+    std::printf("document_edits: %zu edit sequences\n", sequences);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+// Checks how the interactive mode decodes \u escapes in the JSON strings
+// of requests, surrogate pairs and lone surrogates in particular. The text
+// of each request ends in a comment, so only where the escapes put a line
+// break decides whether the statement after them is parsed and reported.
+
+#include <cstdio>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "interactive.hpp"
+
+// Opens `text` as a document and returns the response.
+static std::string open(std::string_view text)
+{
+    std::istringstream in(
+        "{\"method\": \"open\", \"text\": \"" + std::string(text) +
+        "\"}\n{\"method\": \"exit\"}\n"
+    );
+    std::ostringstream out;
+    serve(in, out);
+    return out.str();
+}
+
+struct Case
+{
+    std::string_view text;
+    // what the response has to contain
+    std::string_view expected;
+};
+
+static constexpr Case cases[] = {
+    // a pair, with an escaped line break after it
+    {R"(let x = 1; // \ud83d\ude00\u000a print x +;)", "Expected expression"},
+    // a high surrogate followed by something else than a low one, which
+    // is still read
+    {R"(let x = 1; // \ud800\u000a print x +;)", "Expected expression"},
+    {R"(let x = 1; // \ud800\n print x +;)", "Expected expression"},
+    // a low surrogate on its own
+    {R"(let x = 1; // \udc00\u000a print x +;)", "Expected expression"},
+    // malformed escapes
+    {R"(let x = 1; // \ud800\u00 print x;)", "Malformed request"},
+    {R"(let x = 1; // \ud80)", "Malformed request"},
+    // no line break, so the rest is a comment
+    {R"(let x = 1; // \ud800\udc00 print x +;)", "\"diagnostics\": []"},
+};
+
+int main()
+{
+    bool passed = true;
+    for (Case const &test : cases)
+    {
+        std::string response = open(test.text);
+        if (response.find(test.expected) == std::string::npos)
+        {
+            std::fprintf(
+                stderr, "interactive_strings: %.*s\n  answered %s",
+                static_cast<int>(test.text.size()), test.text.data(),
+                response.c_str()
+            );
+            passed = false;
+        }
+    }
+    std::printf("interactive_strings: %zu requests\n", std::size(cases));
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+// Checks that the parser makes no heap allocations per grammar rule, by
+// counting every operator new while it parses declarations in pipelined
+// mode. Once the first declarations have grown the tree, the token window
+// and the parser's stacks, reparsing into them must not allocate at all.
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "common/error.hpp"
+#include "common/interner.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+
+static size_t allocations = 0;
+
+void *operator new(size_t size)
+{
+    ++allocations;
+    if (void *ptr = std::malloc(size == 0 ? 1 : size))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+// Tries every rule of the grammar, with nested blocks, calls and
+// functions.
+static constexpr char const *declaration = R"(
+fn outer(a, b, c) {
+    let x = -a + b * (c - 1) / 2;
+    let y;
+    fn inner(p) { print p; }
+    if (x <= b && !(c == 3) || a != 0) {
+        inner(outer(x, y = x, 1));
+    } else if (x > 1) {
+        print 7;
+    } else {
+        { x = x - 1; }
+    }
+    while (x >= 0) { x = x - 1; }
+    for (let i = 0; i < 3; i = i + 1) print i;
+    for (; x < 2;) x = x + 1;
+    for (y = 0; ; ) { inner(y); }
+    inner();
+}
+)";
+
+// declarations parsed before counting, to reach the steady state
+static constexpr size_t warm_up = 4;
+static constexpr size_t counted = 2000;
+
+int main()
+{
+    std::string source;
+    for (size_t ix = 0; ix < warm_up + counted; ++ix)
+    {
+        source += declaration;
+    }
+
+    std::string diagnostics;
+    error::DiagnosticEngine engine(diagnostics);
+    engine.set_source(source);
+    common::Interner interner;
+    Lexer lexer(source, interner);
+    Parser parser(lexer, source);
+
+    for (size_t ix = 0; ix < warm_up; ++ix)
+    {
+        parser.parse_next();
+    }
+    size_t before = allocations;
+    size_t parsed = 0;
+    while (parser.parse_next())
+    {
+        ++parsed;
+    }
+    size_t made = allocations - before;
+    engine.flush();
+
+    if (parser.had_error() || !diagnostics.empty() || parsed != counted)
+    {
+        std::fprintf(stderr, "parser_allocations: parse failed\n%s",
+                     diagnostics.c_str());
+        return 1;
+    }
+    std::printf(
+        "parser_allocations: %zu allocations over %zu declarations\n", made,
+        parsed
+    );
+    return made == 0 ? 0 : 1;
+}
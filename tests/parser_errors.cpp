@@ -0,0 +1,78 @@
+// Checks where the parser reports syntax errors, with the whole token list
+// and streaming from the lexer, in particular when the very first token is
+// already wrong and no token before it can locate the error.
+
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <string_view>
+#include <vector>
+
+#include "common/error.hpp"
+#include "common/interner.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+
+struct Case
+{
+    std::string_view source;
+    // the offset of the first diagnostic
+    uint32_t offset;
+};
+
+static constexpr Case cases[] = {
+    {")", 0},
+    {"  + 1;", 2},
+    {"}", 0},
+    {"= 2;", 0},
+    {"/{ let z = 1; }", 0},
+    // after the first token, errors are located at the one before
+    {"let x = 1;\n)", 9},
+    {"print (1;", 7},
+};
+
+static uint32_t first_error(std::string_view source, bool streaming)
+{
+    std::vector<error::Diagnostic> diagnostics;
+    error::Capture capture(diagnostics);
+    common::Interner interner;
+    try
+    {
+        Lexer lexer(source, interner);
+        if (streaming)
+        {
+            Parser(lexer, source).parse();
+        }
+        else
+        {
+            Parser(lexer.lex(), source).parse();
+        }
+    }
+    catch (error::Fatal const &)
+    {
+    }
+    return diagnostics.empty() ? error::no_offset : diagnostics[0].offset;
+}
+
+int main()
+{
+    bool passed = true;
+    for (Case const &test : cases)
+    {
+        for (bool streaming : {false, true})
+        {
+            uint32_t offset = first_error(test.source, streaming);
+            if (offset != test.offset)
+            {
+                std::fprintf(
+                    stderr, "parser_errors: %.*s%s at %u, not %u\n",
+                    static_cast<int>(test.source.size()), test.source.data(),
+                    streaming ? " (streaming)" : "", offset, test.offset
+                );
+                passed = false;
+            }
+        }
+    }
+    std::printf("parser_errors: %zu sources\n", std::size(cases));
+    return passed ? 0 : 1;
+}
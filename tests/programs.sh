@@ -0,0 +1,46 @@
+#!/bin/sh
+# Compiles every program in tests/programs with the given compiler, with and
+# without --optimize and --pipeline, runs it and compares what it prints to
+# the .expected file next to it. A .ir file next to a program holds the IR
+# --optimize has to leave of it, so the passes it is there for can not
+# silently stop firing.
+
+compiler=$(realpath "$1")
+programs=$(realpath "$(dirname "$0")/programs")
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+failures=0
+runs=0
+for program in "$programs"/*.cp; do
+    name=$(basename "$program" .cp)
+    for flags in "" "--optimize" "--pipeline" "--optimize --pipeline"; do
+        runs=$((runs + 1))
+        # the program leaves through the exit syscall, which does not flush
+        # what printf buffered for the pipe
+        if ! (cd "$work" &&
+            "$compiler" $flags "$program" > compile.log 2>&1 &&
+            nasm -f elf64 test.asm -o test.o &&
+            gcc -no-pie -nostartfiles test.o -o test &&
+            stdbuf -o0 ./test > output); then
+            echo "programs: $name ${flags:-(no flags)}: failed to build or run"
+            cat "$work/compile.log"
+            failures=$((failures + 1))
+        elif ! diff -u "$programs/$name.expected" "$work/output"; then
+            echo "programs: $name ${flags:-(no flags)}: wrong output"
+            failures=$((failures + 1))
+        fi
+    done
+    if [ -f "$programs/$name.ir" ]; then
+        runs=$((runs + 1))
+        if ! (cd "$work" && "$compiler" --optimize --emit=ir "$program") \
+            > "$work/ir" 2>&1 ||
+            ! diff -u "$programs/$name.ir" "$work/ir"; then
+            echo "programs: $name: optimized IR changed"
+            failures=$((failures + 1))
+        fi
+    fi
+done
+
+echo "programs: $runs runs, $failures failed"
+[ "$failures" -eq 0 ]
@@ -0,0 +1,36 @@
+// Blocks that can not be reached, blocks left empty and values nothing
+// reads: all of them have to go without taking live code along.
+fn unreachable(n) {
+    while (0) {
+        print 1;
+    }
+    if (n - n) {
+        print 2;
+    }
+    print 3;
+}
+
+fn empty(n) {
+    if (n > 1) {
+    } else {
+    }
+    for (let i = 0; i < n; i = i + 1) {
+    }
+    let unused = n * 7 + 2;
+    unused = unused - 1;
+    print n;
+}
+
+fn empty_arm(n) {
+    let x = n;
+    if (n > 1) {
+        x = x * 2;
+    } else {
+    }
+    print x;
+}
+
+unreachable(4);
+empty(2);
+empty_arm(1);
+empty_arm(5);
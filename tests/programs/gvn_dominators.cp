@@ -0,0 +1,39 @@
+// An expression computed in a block is available in every block it
+// dominates, but not in a sibling arm or after a join it does not dominate.
+fn dominated(a, b) {
+    let x = a * b + 1;
+    if (a > b) {
+        let y = a * b + 1;
+        print y - x;
+        if (b > 0) {
+            print a * b + 1;
+        }
+    } else {
+        print a * b;
+    }
+    print a * b + 1;
+}
+
+fn siblings(a, b) {
+    let r = 0;
+    if (a > b) {
+        r = a - b;
+    } else {
+        r = b - a;
+    }
+    print r;
+    print a - b;
+}
+
+fn redefined(a, b) {
+    let x = a + b;
+    a = a + 1;
+    let y = a + b;
+    print y - x;
+}
+
+dominated(5, 3);
+dominated(2, 4);
+siblings(7, 2);
+siblings(1, 6);
+redefined(10, 20);
@@ -0,0 +1,65 @@
+// Computations that do not change in a loop move to its preheader, which
+// also runs when the loop body never does, so what moves there must not
+// change what the program does when the loop runs zero times.
+fn invariant(a, b, n) {
+    let total = 0;
+    for (let i = 0; i < n; i = i + 1) {
+        let k = a * b + 3;
+        total = total + k;
+    }
+    print total;
+}
+
+fn zero_trip(a, n) {
+    let last = 0 - 1;
+    let i = 0;
+    while (i < n) {
+        last = a * 4;
+        i = i + 1;
+    }
+    print last;
+}
+
+fn guarded(a, n) {
+    let total = 0;
+    let i = 0;
+    while (i < n) {
+        if (a != 0) {
+            total = total + a * 10;
+        }
+        i = i + 1;
+    }
+    print total;
+}
+
+fn nested(a, n) {
+    let total = 0;
+    for (let i = 0; i < n; i = i + 1) {
+        for (let j = 0; j < n; j = j + 1) {
+            total = total + a * a + i * 2;
+        }
+    }
+    print total;
+}
+
+// Only compiled, as the assembly does not divide yet: the divisions may
+// trap, so they stay in the loop.
+fn divides(a, n) {
+    let total = 0;
+    let i = 0;
+    while (i < n) {
+        if (a != 0) {
+            total = total + 100 / a + 100 / 4;
+        }
+        i = i + 1;
+    }
+    print total;
+}
+
+invariant(2, 5, 3);
+invariant(2, 5, 0);
+zero_trip(6, 2);
+zero_trip(2, 0);
+guarded(0, 3);
+guarded(4, 3);
+nested(3, 2);
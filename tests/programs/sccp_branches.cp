@@ -0,0 +1,41 @@
+// Conditions that are constant only once constants are propagated through
+// the branches: the dead arms must go, and so must what they assigned.
+fn folded(n) {
+    let k = 3;
+    let flag = k * 2 - 6;
+    if (flag) {
+        k = 100;
+    } else {
+        k = k + 1;
+    }
+    if (k == 4) {
+        print k;
+    } else {
+        print n;
+    }
+}
+
+fn loop_constant(n) {
+    let x = 7;
+    let i = 0;
+    while (i < n) {
+        if (x != 7) {
+            x = x + 1;
+        }
+        i = i + 1;
+    }
+    print x;
+}
+
+fn not_constant(n) {
+    let k = 1;
+    if (n > 2) {
+        k = 2;
+    }
+    print k;
+}
+
+folded(9);
+loop_constant(5);
+not_constant(1);
+not_constant(3);
@@ -0,0 +1,50 @@
+// Variables carried around loops need phis at the headers, and the copies
+// out of SSA must not clobber each other when they swap values.
+fn fib(n) {
+    let a = 0;
+    let b = 1;
+    let i = 0;
+    while (i < n) {
+        let t = a + b;
+        a = b;
+        b = t;
+        i = i + 1;
+    }
+    print a;
+}
+
+fn swap(n) {
+    let x = 1;
+    let y = 2;
+    for (let i = 0; i < n; i = i + 1) {
+        let t = x;
+        x = y;
+        y = t;
+    }
+    print x;
+    print y;
+}
+
+fn nested(n) {
+    let total = 0;
+    let i = 0;
+    while (i < n) {
+        let j = 0;
+        while (j < i) {
+            if (j == 1) {
+                total = total + 10;
+            } else {
+                total = total + 1;
+            }
+            j = j + 1;
+        }
+        i = i + 1;
+    }
+    print total;
+    print i;
+}
+
+fib(10);
+swap(3);
+swap(4);
+nested(4);